@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <usart.h>
+#include <redirect.h>
+#include <timer.h>
+#include <adc.h>
+#include <dma.h>
+
+using hal::sys_tick;
+using namespace hal::gpio;
+using namespace hal::usart;
+using namespace hal::timer;
+using namespace hal::adc;
+using namespace hal::dma;
+
+typedef usart_t<1, PA9, PA10> serial;
+typedef hal::timer::timer_t<3> trig;
+typedef hal::adc::adc_t<1> adc;
+typedef hal::dma::dma_t<1> dma;
+typedef analog_t<PA0> ain0;
+typedef analog_t<PA1> ain1;
+typedef output_t<PC13> led;
+
+static const uint8_t adc_dma_ch = 1;            // adc1 is hard-wired to dma1 channel 1
+static const uint16_t half_buffer_size = 32;
+static const uint16_t buffer_size = half_buffer_size * 2;
+static uint16_t adc_buf[buffer_size];
+static volatile uint32_t sum0 = 0, sum1 = 0;
+
+template<> void handler<interrupt::USART1>()
+{
+    serial::isr();
+}
+
+template<> void handler<interrupt::DMA1_CHANNEL1>()
+{
+    uint32_t sts = dma::interrupt_status<adc_dma_ch>();
+
+    dma::clear_interrupt_flags<adc_dma_ch>();
+
+    if (sts & (dma_half_transfer | dma_transfer_complete))
+    {
+        const uint16_t *p = adc_buf + (sts & dma_transfer_complete ? half_buffer_size : 0);
+        uint32_t s0 = 0, s1 = 0;
+
+        for (uint16_t i = 0; i < half_buffer_size; i += 2)
+        {
+            s0 += *p++;
+            s1 += *p++;
+        }
+
+        sum0 = s0;
+        sum1 = s1;
+        led::write(sts & dma_transfer_complete);
+    }
+}
+
+int main()
+{
+    led::setup();
+    ain0::setup();
+    ain1::setup();
+    serial::setup<115200>();
+    hal::nvic<interrupt::USART1>::enable();
+    stdio_t::bind<serial>();
+    interrupt::enable();
+
+    printf("Hello STM32F103!\n");
+
+    dma::setup();
+    hal::nvic<interrupt::DMA1_CHANNEL1>::enable();
+
+    trig::setup(71, 99);                        // 10kHz at 72MHz
+    trig::master_mode<trig::mm_update>();
+
+    adc::setup();
+    adc::sequence<0, 1>();
+    adc::dma<dma, adc_dma_ch, uint16_t>(adc_buf, buffer_size);
+    adc::trigger<0x4>();                        // TIM3_TRGO
+    adc::enable();
+
+    for (;;)
+    {
+        printf("%lu %lu\n", sum0 / (half_buffer_size / 2), sum1 / (half_buffer_size / 2));
+        sys_tick::delay_ms(100);
+    }
+}
@@ -18,7 +18,7 @@ typedef output_t<PB0> led;
 typedef output_t<PF3> probe;
 typedef hal::timer::timer_t<3> tim;
 typedef hal::adc::adc_t<1> adc;
-typedef hal::dma::dma_t<1> dma;
+typedef hal::dma::dma_t<2> dma;     // adc1 is served by dma2 stream 0
 typedef analog_t<PA3> ain1;
 typedef analog_t<PC0> ain2;
 typedef analog_t<PC3> ain3;
@@ -62,7 +62,7 @@ int main()
 
     adc::setup();
     adc::sequence<1, 2, 15>();
-    adc::dma<dma, 1, uint16_t>(buf, buf_size);
+    adc::dma<dma, 0, uint16_t>(buf, buf_size);
     adc::trigger<0x4>();
     adc::enable();
 
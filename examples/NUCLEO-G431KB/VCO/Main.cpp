@@ -232,7 +232,7 @@ int main()
     encoder_btn::setup<pull_up>();
     push_btn::setup<pull_up>();
 
-    adc_tim::setup(0, sys_clock::freq() / adc_sample_freq - 1);
+    adc_tim::setup_frequency<adc_sample_freq>();
     adc_tim::master_mode<adc_tim::mm_update>();
     //adc_tim::update_interrupt_enable();
     //hal::nvic<interrupt::TIM4>::enable();
@@ -254,7 +254,7 @@ int main()
     adc::enable();
     adc::start_conversion();
 
-    dac_tim::setup(0, sys_clock::freq() / dac_sample_freq - 1);
+    dac_tim::setup_frequency<dac_sample_freq>();
     dac_tim::master_mode<dac_tim::mm_update>();
 
     // enable for sampling frequency probe
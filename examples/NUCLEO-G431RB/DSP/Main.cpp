@@ -4,12 +4,14 @@
 #include <adc.h>
 #include <dac.h>
 #include <dma.h>
+#include <pipeline.h>
 
 using namespace hal::timer;
 using namespace hal::gpio;
 using namespace hal::adc;
 using namespace hal::dac;
 using namespace hal::dma;
+using namespace hal::pipeline;
 using hal::sys_clock;
 
 typedef timer_t<6> tim6;
@@ -21,11 +23,12 @@ typedef hal::dma::dma_t<1> dma;
 
 static const uint8_t dac_dma_ch = 1;
 static const uint8_t adc_dma_ch = 2;
-static const uint16_t half_buffer_size = 128;
-static const uint16_t buffer_size = half_buffer_size * 2;
-static uint16_t input_buffer[buffer_size];
-static uint16_t output_buffer[buffer_size] = { 4095, 0, 4095, 0, 4095 };
+static const uint16_t block_size = 128;
 static const uint32_t sample_freq = 96000;
+static const uint8_t adc_tim6_trgo = 0xd;       // ADC12 EXTSEL
+static const uint8_t dac_tim6_trgo = 7;         // DAC1 TSEL
+
+typedef pipeline_t<tim6, adc, dac, 1, dma, adc_dma_ch, dma, dac_dma_ch, sample_freq, block_size> pipe;
 
 typedef button_t<PC13> btn;
 typedef output_t<PA5> led;
@@ -45,32 +48,16 @@ template<> void handler<interrupt::TIM6_DACUNDER>()
     probe::clear();
 }
 
-template<> void handler<interrupt::DMA1_CH1>()
+template<> void handler<interrupt::DMA1_CH2>()
 {
-    uint32_t sts = dma::interrupt_status<dac_dma_ch>();
-
-    dma::clear_interrupt_flags<dac_dma_ch>();
-
-    if (sts & (dma_half_transfer | dma_transfer_complete))
-        probe::write(sts & dma_transfer_complete);
+    pipe::isr();
 }
 
-template<> void handler<interrupt::DMA1_CH2>()
+static void process(const uint16_t *input, uint16_t *output)
 {
-    uint32_t sts = dma::interrupt_status<adc_dma_ch>();
-
-    dma::clear_interrupt_flags<adc_dma_ch>();
     led::set();
-
-    if (sts & (dma_half_transfer | dma_transfer_complete))
-    {
-        uint16_t *p = input_buffer + (sts & dma_transfer_complete ? half_buffer_size : 0);
-        uint16_t *q = output_buffer + (sts & dma_transfer_complete ? half_buffer_size : 0);
-
-        for (uint16_t i = 0; i < half_buffer_size; ++i)
-            *q++ = *p++;
-    }
-
+    for (uint16_t i = 0; i < block_size; ++i)
+        *output++ = *input++;
     led::clear();
 }
 
@@ -86,25 +73,13 @@ int main()
 
     interrupt::enable();
 
-    dma::setup();
-    hal::nvic<interrupt::DMA1_CH1>::enable();
     hal::nvic<interrupt::DMA1_CH2>::enable();
 
-    dac::setup();
-    dac::enable_trigger<1, 7>();    // FIXME: use constant for TIM6_TRGO
-    dac::enable_dma<1, dma, dac_dma_ch, uint16_t>(output_buffer, buffer_size);
-    dma::enable_interrupt<dac_dma_ch, true>();
-
     ain::setup();
     adc::setup<4>();
     adc::sequence<1>();
-    adc::dma<dma, adc_dma_ch, uint16_t>(input_buffer, buffer_size);
-    adc::trigger<0xd>();            // FIXME: use constant for TIM6_TRGO
-    adc::enable();
-    adc::start_conversion();
 
-    tim6::setup(0, sys_clock::freq() / sample_freq - 1);
-    tim6::master_mode<tim6::mm_update>();
+    pipe::setup<adc_tim6_trgo, dac_tim6_trgo>(process);
     // enable for sampling frequency probe
     //tim6::update_interrupt_enable();
     //hal::nvic<interrupt::TIM6_DACUNDER>::enable();
@@ -22,9 +22,7 @@ typedef hal::dma::dma_t<1> i2sdma;
 static const uint8_t i2sdma_ch = 1;
 
 static const uint16_t buf_size = 128;   // samples per channel
-static int32_t bufa[buf_size * 2];      // interleave both channels
-
-static inline uint32_t swap(uint32_t x) { return x << 16 | x >> 16; }
+static uint32_t bufa[buf_size * 2];     // interleave both channels
 
 void loop();
 
@@ -38,13 +36,15 @@ int main()
         float x = -1. + 2 * static_cast<float>(i) / static_cast<float>(buf_size);
         float y = sin(x*pi);
 
-        bufa[j] = swap(ftoq31(y));
-        bufa[j + 1] = swap(ftoq31(-y * 0.25));
+        bufa[j] = ftoq31(y);
+        bufa[j + 1] = ftoq31(-y * 0.25);
     }
 
+    pack<format_32_32>(reinterpret_cast<int32_t*>(bufa), bufa, buf_size * 2);
+
     i2sdma::setup();
     i2s::setup<philips_i2s, low_level, format_32_32, 27>();
-    i2s::enable_dma<i2sdma, i2sdma_ch>(reinterpret_cast<uint16_t*>(bufa), buf_size * 4);
+    i2s::enable_dma<i2sdma, i2sdma_ch>(bufa, buf_size * 2);
 
     for (;;)
         loop();
@@ -0,0 +1,57 @@
+////
+// 
+//      Full-duplex I2S example
+//
+//      I2S3 is master transmitter, I2S2 slave receiver;
+//      wire PC10 (I2S3_CK) to PB13 (I2S2_CK) and PA15 (I2S3_WS) to PB12 (I2S2_WS)
+//
+////
+
+#include <i2s.h>
+#include <gpio.h>
+
+using hal::sys_tick;
+using namespace hal::gpio;
+using namespace hal::i2s;
+
+typedef output_t<PA5> ld4;
+typedef output_t<PA10> probe;
+typedef i2s_t<3, PC10, PC12, PA15> i2s_tx;
+typedef i2s_t<2, PB13, PA11, PB12> i2s_rx;
+typedef hal::dma::dma_t<1> i2sdma;
+
+static const uint8_t tx_dma_ch = 1;
+static const uint8_t rx_dma_ch = 2;
+static const uint16_t block_size = 64;     // frames per block
+
+typedef i2s_duplex_t<i2s_tx, i2s_rx, i2sdma, tx_dma_ch, i2sdma, rx_dma_ch, format_16_16, block_size> duplex;
+
+template<> void handler<interrupt::DMA1_CH2>()
+{
+    duplex::isr();
+}
+
+static void process(const uint16_t *input, uint16_t *output)
+{
+    probe::set();
+    for (uint16_t i = 0; i < duplex::block_samples; ++i)
+        *output++ = *input++;
+    probe::clear();
+}
+
+int main()
+{
+    ld4::setup();
+    probe::setup();
+
+    interrupt::enable();
+    hal::nvic<interrupt::DMA1_CH2>::enable();
+
+    duplex::setup<philips_i2s, low_level, 27>(process);
+
+    for (;;)
+    {
+        ld4::toggle();
+        sys_tick::delay_ms(100);
+    }
+}
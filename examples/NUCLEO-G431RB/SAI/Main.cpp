@@ -0,0 +1,51 @@
+////
+// 
+//      SAI TDM example
+//
+//      block A is master transmitter with 8 x 32-bit slots at 48kHz,
+//      block B is synchronous slave receiver on the same clocks
+//
+////
+
+#include <sai.h>
+#include <gpio.h>
+
+using hal::sys_tick;
+using namespace hal::gpio;
+using namespace hal::sai;
+
+typedef output_t<PA5> ld4;
+typedef sai_t<block_a, PA8, PA9, PA10> sai_tx;
+typedef sai_sync_t<block_b, PB5> sai_rx;
+typedef hal::dma::dma_t<1> saidma;
+
+static const uint8_t tx_dma_ch = 1;
+static const uint8_t rx_dma_ch = 2;
+static const uint8_t nslots = 8;
+static const uint16_t nframes = 32;
+
+static uint32_t tx_buf[nframes * nslots];
+static uint32_t rx_buf[nframes * nslots];
+
+int main()
+{
+    ld4::setup();
+
+    for (uint16_t i = 0; i < nframes; ++i)
+        for (uint8_t j = 0; j < nslots; ++j)
+            tx_buf[i * nslots + j] = (j << 24) | (i << 16) | 0xaa55;    // slot and frame marker
+
+    saidma::setup();
+    sai_tx::setup<tdm_protocol, master_transmit, data_32, 48000, nslots>();
+    sai_rx::setup<tdm_protocol, slave_receive, data_32, nslots>();
+    sai_rx::enable_rx_dma<saidma, rx_dma_ch>(rx_buf, nframes * nslots);
+    sai_tx::enable_dma<saidma, tx_dma_ch>(tx_buf, nframes * nslots);
+    sai_rx::enable();                       // slave first
+    sai_tx::enable();
+
+    for (;;)
+    {
+        ld4::toggle();
+        sys_tick::delay_ms(100);
+    }
+}
@@ -1,8 +1,7 @@
 #include <stdlib.h>
 #include <usart.h>
 #include <redirect.h>
-#include <cordic.h>
-#include <fixed.h>
+#include <dds.h>
 #include <timer.h>
 #include <button.h>
 #include <gpio.h>
@@ -17,13 +16,11 @@ void __throw_bad_function_call() { for (;;); }
 #include <functional>
 
 using namespace hal::usart;
-using namespace hal::cordic;
 using namespace hal::timer;
 using namespace hal::gpio;
 using namespace hal::adc;
 using namespace hal::dac;
 using namespace hal::dma;
-using namespace fixed;
 using hal::sys_clock;
 
 typedef usart_t<2, PA2, PA3> serial;
@@ -33,7 +30,6 @@ typedef hal::timer::timer_t<3> aux;
 typedef adc_t<1> adc;
 typedef dac_t<1> dac;
 typedef dma_t<1> dac_dma;
-typedef hal::cordic::cordic_t cordic;   // FIXME: leaking device into here?
 
 constexpr uint8_t dac_dma_ch = 1;
 
@@ -66,74 +62,7 @@ template<> void handler<interrupt::TIM6_DACUNDER>()
     probe::clear();
 }
 
-template<typename WAVEGEN>
-class signal_generator_t
-{
-public:
-    void setup(float freq = 440.)
-    {
-        m_phi = -1.;
-        set_freq(freq);
-    }
-
-    void set_freq(float freq)
-    {
-        m_dphi = 2. * freq / sample_freq;
-    }
-
-    float sample()
-    {
-        float s = WAVEGEN::value(m_phi);                // generate signal value
-
-        if ((m_phi += m_dphi) >= 1.)                    // advance and wrap around
-            m_phi -= 2.;
-        return s;
-    }
-
-private:
-    float           m_phi;
-    volatile float  m_dphi;
-};
-
-struct sine
-{
-    static inline float value(float phi)
-    {
-        return q31tof(cordic::compute(ftoq31(phi)));
-    }
-};
-
-struct triangle
-{
-    static inline float value(float phi)
-    {
-        if (phi < -.5)
-            return 2. * phi + 2.;
-        else if (phi < .5)
-            return -2. * phi;
-        else
-            return 2 * phi - 2.;
-        return phi;
-    }
-};
-
-struct sawtooth
-{
-    static inline float value(float phi)
-    {
-        return phi;
-    }
-};
-
-struct square
-{
-    static inline float value(float phi)
-    {
-        return phi < 0 ? 1. : -1.;
-    }
-};
-
-static signal_generator_t<triangle> sig_gen;
+static dds::oscillator_t<dds::triangle, sample_freq> osc;
 
 template<> void handler<interrupt::DMA1_CH1>()
 {
@@ -146,8 +75,7 @@ template<> void handler<interrupt::DMA1_CH1>()
         uint16_t *p = output_buffer + (sts & dma_transfer_complete ? half_buffer_size : 0);
 
         probe::set();
-        for (uint16_t i = 0; i < half_buffer_size; ++i)
-            *p++ = (sig_gen.sample() + 1.01) * 2010.;            // FIXME: correct for clipping
+        osc.render(p, half_buffer_size);
         probe::clear();
     }
 }
@@ -164,9 +92,7 @@ int main()
     probe::setup();
     led::setup();
 
-    cordic::setup<cordic::sine, 4>();
-
-    sig_gen.setup();
+    osc.setup();
 
     ain::setup();
     adc::setup<4>();
@@ -192,19 +118,19 @@ int main()
     dac::enable_dma<1, dac_dma, dac_dma_ch, uint16_t>(output_buffer, buffer_size);
     dac_dma::enable_interrupt<dac_dma_ch, true>();
 
-    float f = 440.;
+    uint32_t dphi = osc.increment(440);
 
     for (;;)
     {
         if (btn::read())
         {    
-            f = led::read() ? 440 : 4186.009;   // A4 : C8
+            dphi = osc.increment(led::read() ? 440 : 4186);    // A4 : C8
             led::toggle();
         }
 
-        float x = adc::read() * (1./2048.) - 1.;
+        int32_t x = static_cast<int32_t>(adc::read()) - 2048;
 
-        sig_gen.set_freq(f * (1 + 0.5 * x));
+        osc.set_increment(dphi + ((static_cast<int64_t>(dphi >> 1) * x) >> 11));
     }
 }
 
@@ -3,17 +3,44 @@
 namespace internal
 {
 
+#if defined(HAVE_PERIPHERAL_ADC1)
 template<> struct adc_traits<1>
 {
     typedef device::adc1_t T;
     static inline T& ADC() { return device::ADC1; }
+    static constexpr uint8_t dma_request = 0;               // stream channel selection (F4/F7)
 };
+#endif
 
+#if defined(HAVE_PERIPHERAL_ADC2)
 template<> struct adc_traits<2>
 {
     typedef device::adc2_t T;
     static inline T& ADC() { return device::ADC2; }
+    static constexpr uint8_t dma_request = 1;               // stream channel selection (F4/F7)
 };
+#endif
+
+#if defined(HAVE_PERIPHERAL_ADC3)
+template<> struct adc_traits<3>
+{
+    typedef device::adc3_t T;
+    static inline T& ADC() { return device::ADC3; }
+    static constexpr uint8_t dma_request = 2;               // stream channel selection (F4/F7)
+};
+#endif
+
+template<uint16_t> struct prescale_traits {};
+
+template<> struct prescale_traits<2> { static const uint8_t presc = 0x0; };
+template<> struct prescale_traits<4> { static const uint8_t presc = 0x1; };
+template<> struct prescale_traits<6> { static const uint8_t presc = 0x2; };
+template<> struct prescale_traits<8> { static const uint8_t presc = 0x3; };
+
+static constexpr uint32_t sample_time_bits(uint8_t x, uint8_t n)
+{
+    return n == 0 ? 0 : (sample_time_bits(x, n - 1) << 3) | x;
+}
 
 template<uint8_t NO>
 struct adc_impl_f1
@@ -27,88 +54,120 @@ struct adc_impl_f1
         using namespace device;
 
         peripheral_traits<_>::enable();                         // enable adc clock
-        /*
-        ADC().CR = _::CR_RESET_VALUE;                           // reset control register
-        ADC().IER = _::IER_RESET_VALUE;                         // reset interrupt register
-        ADC().CFGR1 = _::CFGR1_RESET_VALUE                      // reset configuration register 1
-                    | _::CFGR1_CHSELRMOD                        // use alternate channel selection mode
-                    | _::CFGR1_OVRMOD                           // overwrite on overrun
-                    ;
-        ADC().CFGR2 = _::CFGR2_RESET_VALUE                      // reset configuration register 2
-                    | _::template CFGR2_CKMODE<0x3>             // use PCLK synchronous mode
-                    ;
-                    */
+        ADC().CR1 = _::CR1_RESET_VALUE                          // reset control register 1
+                  | _::CR1_SCAN                                 // scan the regular sequence
+                  ;
+#if defined(STM32F1)
+        // adc clock must not exceed 14MHz, PCLK2 / 6 = 12MHz at 72MHz
+        constexpr uint16_t presc = PRESCALE == 1 ? 6 : PRESCALE;
+
+        RCC.CFGR &= ~rcc_t::template CFGR_ADCPRE<0x3>;          // clear adc prescaler
+        RCC.CFGR |= rcc_t::template CFGR_ADCPRE<prescale_traits<presc>::presc>;
+        ADC().CR2 = _::CR2_RESET_VALUE                          // reset control register 2
+                  | _::CR2_EXTTRIG                              // enable external trigger
+                  | _::template CR2_EXTSEL<0x7>                 // software trigger (SWSTART)
+                  ;
+#else
+#if defined(HAVE_PERIPHERAL_ADC_COMMON)
+        constexpr uint16_t presc = PRESCALE == 1 ? 4 : PRESCALE;
+
+        ADC_COMMON.CCR = adc_common_t::CCR_RESET_VALUE          // reset common control register
+                       | adc_common_t::template CCR_ADCPRE<prescale_traits<presc>::presc>
+                       ;
+#else
+        static_assert(PRESCALE == 1, "ADC prescale other than 1 currently unsupported by driver");
+#endif
+        ADC().CR2 = _::CR2_RESET_VALUE;                         // reset control register 2
+#endif
     }
 
     static void enable()
     {
         using namespace device;
 
-        /*
-        uint32_t saved_dmaen = ADC().CFGR1 & _::CFGR1_DMAEN;    // save DMA flag 
-
-        ADC().CR |= _::CR_ADVREGEN;                             // enable adc voltage regulator
-        sys_clock::delay_us(10);                                // wait for regulator to stabilize
-        ADC().CFGR1 &= ~_::CFGR1_DMAEN;                         // ensure DMA is disabled during calibration
-        ADC().CR |= _::CR_ADCAL;                                // start calibration
-        while (ADC().CR & _::CR_ADCAL);                         // wait for calibration to complete
-        ADC().CFGR1 |= saved_dmaen;                             // restore DMA setting
-        for (volatile uint8_t i = 0; i < 4; ++i);               // cycles between calibration and adc enable
-        ADC().CR |= _::CR_ADEN;                                 // enable adc 
-        while (!(ADC().ISR & _::ISR_ADRDY));                    // wait for adc ready 
-        */
+        ADC().CR2 |= _::CR2_ADON;                               // power up adc
+        sys_tick::delay_us(10);                                 // wait for adc to stabilize
+#if defined(STM32F1)
+        ADC().CR2 |= _::CR2_RSTCAL;                             // reset calibration
+        while (ADC().CR2 & _::CR2_RSTCAL);                      // wait for reset to complete
+        ADC().CR2 |= _::CR2_CAL;                                // start calibration
+        while (ADC().CR2 & _::CR2_CAL);                         // wait for calibration to complete
+#endif
     }
 
-    static constexpr uint8_t nulch = 0xf;
+    template<uint8_t X>
+    static void sample_time()
+    {
+        ADC().SMPR1 = sample_time_bits(X, 8);                   // channels 10..17
+        ADC().SMPR2 = sample_time_bits(X, 10);                  // channels 0..9
+    }
+
+    static constexpr uint8_t nulch = 0x1f;
 
     template< uint8_t S1, uint8_t S2 = nulch, uint8_t S3 = nulch, uint8_t S4 = nulch
             , uint8_t S5 = nulch, uint8_t S6 = nulch, uint8_t S7 = nulch, uint8_t S8 = nulch>
     static void sequence()
     {
-/*
         using namespace device;
 
-        ADC().ISR &= ~_::ISR_CCRDY;                             // clear channel config ready flag
-        ADC().CHSELR = _::template CHSELR_SQ1<S1>               // sequence slot 1
-                     | _::template CHSELR_SQ2<S2>               // sequence slot 2
-                     | _::template CHSELR_SQ3<S3>               // sequence slot 3
-                     | _::template CHSELR_SQ4<S4>               // sequence slot 4
-                     | _::template CHSELR_SQ5<S5>               // sequence slot 5
-                     | _::template CHSELR_SQ6<S6>               // sequence slot 6
-                     | _::template CHSELR_SQ7<S7>               // sequence slot 7
-                     | _::template CHSELR_SQ8<S8>               // sequence slot 8
-                  ;
-        while (!(ADC().ISR & _::ISR_CCRDY));                    // wait for channel selection to be ready
-       */
+        static constexpr uint8_t L = (S2 != nulch ? 1 : 0)
+                                   + (S3 != nulch ? 1 : 0)
+                                   + (S4 != nulch ? 1 : 0)
+                                   + (S5 != nulch ? 1 : 0)
+                                   + (S6 != nulch ? 1 : 0)
+                                   + (S7 != nulch ? 1 : 0)
+                                   + (S8 != nulch ? 1 : 0)
+                                   ;
+
+        ADC().SQR1 = _::SQR1_RESET_VALUE                        // reset sequence 1 register
+                   | _::template SQR1_L<L>                      // sequence length less one
+                   ;
+        ADC().SQR2 = _::SQR2_RESET_VALUE                        // reset sequence 2 register
+                   | _::template SQR2_SQ7<S7>                   // sequence slot 7
+                   | _::template SQR2_SQ8<S8>                   // sequence slot 8
+                   ;
+        ADC().SQR3 = _::SQR3_RESET_VALUE                        // reset sequence 3 register
+                   | _::template SQR3_SQ1<S1>                   // sequence slot 1
+                   | _::template SQR3_SQ2<S2>                   // sequence slot 2
+                   | _::template SQR3_SQ3<S3>                   // sequence slot 3
+                   | _::template SQR3_SQ4<S4>                   // sequence slot 4
+                   | _::template SQR3_SQ5<S5>                   // sequence slot 5
+                   | _::template SQR3_SQ6<S6>                   // sequence slot 6
+                   ;
     }
 
     template<typename DMA, uint8_t DMACH, typename T>
     static inline void dma(volatile T *dest, uint16_t nelem)
     {
-            /*
         using namespace device;
 
-        ADC().CFGR1 |= _::CFGR1_DMAEN                               // enable adc channel dma
-                    |  _::CFGR1_DMACFG                              // select circular mode
-                    ;
+        ADC().CR2 |= _::CR2_DMA                                     // enable adc dma requests
+#if !defined(STM32F1)
+                  |  _::CR2_DDS                                     // keep issuing requests (circular)
+#endif
+                  ;
         DMA::template disable<DMACH>();                             // disable dma channel
         DMA::template periph_to_mem<DMACH>(&ADC().DR, dest, nelem); // configure dma from memory
+        DMA::template request<DMACH, adc_traits<NO>::dma_request>(); // route adc request
         DMA::template enable<DMACH>();                              // enable dma channel
-        dma::dmamux_traits<DMA::INST, DMACH>::CCR() = device::dmamux_t::C0CR_DMAREQ_ID<5>;
         DMA::template enable_interrupt<DMACH, true>();
-        */
     }
 
     template<uint8_t SEL>
     static inline void trigger()
     {
-            /*
         using namespace device;
 
-        ADC().CFGR1 |= _::template CFGR1_EXTEN<0x1>                 // hardware trigger on rising edge
-                    |  _::template CFGR1_EXTSEL<SEL>                // trigger source selection
-                    ;
-                    */
+#if defined(STM32F1)
+        ADC().CR2 &= ~_::template CR2_EXTSEL<0x7>;                  // clear trigger source selection
+        ADC().CR2 |= _::CR2_EXTTRIG                                 // hardware trigger
+                  |  _::template CR2_EXTSEL<SEL>                    // trigger source selection
+                  ;
+#else
+        ADC().CR2 |= _::template CR2_EXTEN<0x1>                     // hardware trigger on rising edge
+                  |  _::template CR2_EXTSEL<SEL>                    // trigger source selection
+                  ;
+#endif
     }
 
     static inline void start_conversion()
@@ -121,11 +180,10 @@ struct adc_impl_f1
         using namespace device;
 
         start_conversion();                                     // start conversion
-        while (!(ADC().ISR & _::ISR_EOC));                      // conversion complete
+        while (!(ADC().SR & _::SR_EOC));                        // conversion complete
         return ADC().DR;                                        // read data register
     }
 };
 
 } // namespace internal
 
-
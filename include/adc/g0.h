@@ -82,8 +82,8 @@ struct adc_impl_g0
                     ;
         DMA::template disable<DMACH>();                             // disable dma channel
         DMA::template periph_to_mem<DMACH>(&ADC().DR, dest, nelem); // configure dma from memory
+        DMA::template request<DMACH, dma::ADC>();                   // route adc request
         DMA::template enable<DMACH>();                              // enable dma channel
-        dma::dmamux_traits<DMA::INST, DMACH>::CCR() = device::dmamux_t::C0CR_DMAREQ_ID<5>;
         DMA::template enable_interrupt<DMACH, true>();
     }
 
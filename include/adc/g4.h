@@ -9,6 +9,7 @@ template<> struct adc_traits<1>
     typedef device::adc12_common_t C;
     static inline T& ADC() { return device::ADC1; }
     static inline C& COMMON() { return device::ADC12_COMMON; }
+    static constexpr dma::resource_t dma_request = dma::ADC1;
 };
 
 template<> struct adc_traits<2>
@@ -17,6 +18,7 @@ template<> struct adc_traits<2>
     typedef device::adc12_common_t C;
     static inline T& ADC() { return device::ADC2; }
     static inline C& COMMON() { return device::ADC12_COMMON; }
+    static constexpr dma::resource_t dma_request = dma::ADC2;
 };
 
 template<uint16_t> struct prescale_traits {};
@@ -163,8 +165,8 @@ struct adc_impl_g4
                    ;
         DMA::template disable<DMACH>();                             // disable dma channel
         DMA::template periph_to_mem<DMACH>(&ADC().DR, dest, nelem); // configure dma from memory
+        DMA::template request<DMACH, adc_traits<NO>::dma_request>(); // route adc request
         DMA::template enable<DMACH>();                              // enable dma channel
-        dma::dmamux_traits<DMA::INST, DMACH>::CCR() = device::dmamux_t::C0CR_DMAREQ_ID<5>;
         DMA::template enable_interrupt<DMACH, true>();
     }
 
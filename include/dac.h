@@ -19,6 +19,16 @@ template<> struct dac_traits<1>
     static inline T& DAC() { return device::DAC; }
     static constexpr gpio::gpio_pin_t ch1_pin = gpio::PA4;
     static constexpr gpio::gpio_pin_t ch2_pin = gpio::PA5;
+#if defined(STM32G0)
+    static constexpr uint8_t ch1_dma_request = dma::DAC_CH1;
+    static constexpr uint8_t ch2_dma_request = dma::DAC_CH2;
+#elif defined(STM32F4) || defined(STM32F7)
+    static constexpr uint8_t ch1_dma_request = 7;           // dma1 stream 5 channel selection
+    static constexpr uint8_t ch2_dma_request = 7;           // dma1 stream 6 channel selection
+#else
+    static constexpr uint8_t ch1_dma_request = 0;           // fixed dma mapping
+    static constexpr uint8_t ch2_dma_request = 0;           // fixed dma mapping
+#endif
 };
 #elif defined(HAVE_PERIPHERAL_DAC1)
 template<> struct dac_traits<1>
@@ -27,6 +37,9 @@ template<> struct dac_traits<1>
     static inline T& DAC() { return device::DAC1; }
     static constexpr gpio::gpio_pin_t ch1_pin = gpio::PA4;
     static constexpr gpio::gpio_pin_t ch2_pin = gpio::PA5;
+    static constexpr uint8_t ch1_dma_request = dma::DAC1_CH1;
+    static constexpr uint8_t ch2_dma_request = dma::DAC1_CH2;
+    static constexpr uint8_t mode = 0x0;                    // external pin, buffer enabled
 };
 #endif
 
@@ -36,6 +49,30 @@ template<> struct dac_traits<2>
     typedef device::dac2_t T;
     static inline T& DAC() { return device::DAC2; }
     static constexpr gpio::gpio_pin_t ch1_pin = gpio::PA7;  // FIXME: check this!
+    static constexpr uint8_t ch1_dma_request = dma::DAC2_CH1;
+    static constexpr uint8_t mode = 0x0;                    // external pin, buffer enabled
+};
+#endif
+
+#if defined(HAVE_PERIPHERAL_DAC3)
+template<> struct dac_traits<3>                             // internal only (comparators, op-amps)
+{
+    typedef device::dac3_t T;
+    static inline T& DAC() { return device::DAC3; }
+    static constexpr uint8_t ch1_dma_request = dma::DAC3_CH1;
+    static constexpr uint8_t ch2_dma_request = dma::DAC3_CH2;
+    static constexpr uint8_t mode = 0x3;                    // on-chip peripherals, buffer disabled
+};
+#endif
+
+#if defined(HAVE_PERIPHERAL_DAC4)
+template<> struct dac_traits<4>                             // internal only (comparators, op-amps)
+{
+    typedef device::dac4_t T;
+    static inline T& DAC() { return device::DAC4; }
+    static constexpr uint8_t ch1_dma_request = dma::DAC4_CH1;
+    static constexpr uint8_t ch2_dma_request = dma::DAC4_CH2;
+    static constexpr uint8_t mode = 0x3;                    // on-chip peripherals, buffer disabled
 };
 #endif
 
@@ -45,14 +82,23 @@ template<uint8_t NO> struct dac_channel_traits<NO, 1>
 {
     typedef typename dac_traits<NO>::T _;
     static inline typename dac_traits<NO>::T& DAC() { return dac_traits<NO>::DAC(); }
-    static constexpr gpio::gpio_pin_t pin = dac_traits<NO>::ch1_pin;
+    static constexpr gpio::gpio_pin_t pin() { return dac_traits<NO>::ch1_pin; }
+    static constexpr uint8_t dma_request = dac_traits<NO>::ch1_dma_request;
     static constexpr uint32_t CR_EN = _::CR_EN1;
     static constexpr uint32_t CR_TEN = _::CR_TEN1;
     static constexpr uint32_t CR_DMAEN = _::CR_DMAEN1;
+#if defined(STM32F1)
+    static constexpr uint32_t CR_DMAUDRIE = 0;                  // no underrun interrupt
+#else
     static constexpr uint32_t CR_DMAUDRIE = _::CR_DMAUDRIE1;
+#endif
     static constexpr uint32_t SWTRGR_SWTRIG = _::SWTRGR_SWTRIG1;
+#if defined(STM32G4)
+    static constexpr uint32_t MCR_DMADOUBLE = _::MCR_DMADOUBLE1;
+#endif
     template<uint32_t X> static constexpr uint32_t CR_TSEL = _::template CR_TSEL1<X>;
     template<uint32_t X> static constexpr uint32_t CR_WAVE = _::template CR_WAVE1<X>;
+    template<uint32_t X> static constexpr uint32_t CR_MAMP = _::template CR_MAMP1<X>;
     template<uint32_t X> static constexpr uint32_t STMODR_STINCTRIGSEL = _::template STMODR_STINCTRIGSEL1<X>;
     template<uint32_t X> static constexpr uint32_t STMODR_STRSTTRIGSEL = _::template STMODR_STRSTTRIGSEL1<X>;
     static inline volatile uint32_t& STR() { return DAC().STR1; }
@@ -64,14 +110,23 @@ template<uint8_t NO> struct dac_channel_traits<NO, 2>
 {
     typedef typename dac_traits<NO>::T _;
     static inline typename dac_traits<NO>::T& DAC() { return dac_traits<NO>::DAC(); }
-    static constexpr gpio::gpio_pin_t pin = dac_traits<NO>::ch2_pin;
+    static constexpr gpio::gpio_pin_t pin() { return dac_traits<NO>::ch2_pin; }
+    static constexpr uint8_t dma_request = dac_traits<NO>::ch2_dma_request;
     static constexpr uint32_t CR_EN = _::CR_EN2;
     static constexpr uint32_t CR_TEN = _::CR_TEN2;
     static constexpr uint32_t CR_DMAEN = _::CR_DMAEN2;
+#if defined(STM32F1)
+    static constexpr uint32_t CR_DMAUDRIE = 0;                  // no underrun interrupt
+#else
     static constexpr uint32_t CR_DMAUDRIE = _::CR_DMAUDRIE2;
+#endif
     static constexpr uint32_t SWTRGR_SWTRIG = _::SWTRGR_SWTRIG2;
+#if defined(STM32G4)
+    static constexpr uint32_t MCR_DMADOUBLE = _::MCR_DMADOUBLE2;
+#endif
     template<uint32_t X> static constexpr uint32_t CR_TSEL = _::template CR_TSEL2<X>;
     template<uint32_t X> static constexpr uint32_t CR_WAVE = _::template CR_WAVE2<X>;
+    template<uint32_t X> static constexpr uint32_t CR_MAMP = _::template CR_MAMP2<X>;
     template<uint32_t X> static constexpr uint32_t STMODR_STINCTRIGSEL = _::template STMODR_STINCTRIGSEL2<X>;
     template<uint32_t X> static constexpr uint32_t STMODR_STRSTTRIGSEL = _::template STMODR_STRSTTRIGSEL2<X>;
     static inline volatile uint32_t& STR() { return DAC().STR2; }
@@ -90,17 +145,25 @@ struct dac_t
         device::peripheral_traits<_>::enable();                 // enable dac clock
 
         DAC().CR = _::CR_RESET_VALUE;                   // reset control register
+#if defined(STM32G4)
+        const uint32_t hclk = sys_clock::freq();        // assumes AHB prescaler of 1
+
         DAC().MCR = _::MCR_RESET_VALUE                  // reset mode control register
-#if !defined(STM32G070)
-                  | _::template MCR_HFSEL<0x2>          // high-frequency mode (AHB > 160MHz)
-#endif
+                  | (hclk > 160000000 ? _::template MCR_HFSEL<0x2>  // high-frequency mode (AHB > 160MHz)
+                  :  hclk > 80000000 ? _::template MCR_HFSEL<0x1>   // high-frequency mode (AHB > 80MHz)
+                  :  0)
+                  | _::template MCR_MODE1<dac_traits<NO>::mode>     // channel 1 connection and buffer
+                  | _::template MCR_MODE2<dac_traits<NO>::mode>     // channel 2 connection and buffer
                   ;
+#elif defined(STM32G0)
+        DAC().MCR = _::MCR_RESET_VALUE;                 // reset mode control register
+#endif
     }
 
     template<uint8_t CH>
     static inline void setup_pin()
     {
-        gpio::analog_t<dac_channel_traits<NO, CH>::pin>::template setup<gpio::floating>();
+        gpio::analog_t<dac_channel_traits<NO, CH>::pin()>::template setup<gpio::floating>();
     }
 
     template<uint8_t CH, uint8_t RST, uint8_t INC>
@@ -136,15 +199,94 @@ struct dac_t
         DAC().CR |= dac_channel_traits<NO, CH>::CR_DMAUDRIE;    // enable dac dma underrun interrupt
         DMA::template disable<DMACH>();                                 // disable dma channel
         DMA::template mem_to_periph<DMACH>(source, nelem, &reg);    // configure dma from memory
+        DMA::template request<DMACH, dac_channel_traits<NO, CH>::dma_request>(); // route dac request
         DMA::template enable<DMACH>();                                  // enable dma channel
-#if defined(STM32G431)
-        dma::dmamux_traits<DMA::INST, DMACH>::CCR() = device::dmamux_t::C0CR_DMAREQ_ID<6>;
-#elif defined(STM32G070)
-        dma::dmamux_traits<DMA::INST, DMACH>::CCR() = device::dmamux_t::C0CR_DMAREQ_ID<8>;
-#endif
         enable<CH>();                                               // enable dac channel
     }
 
+    // dual channel mode: both channels share one trigger and one dma channel
+    // driven by channel 1 requests; samples are packed as ch2 << 16 | ch1 for
+    // 12-bit output through DHR12RD (uint32_t) or ch2 << 8 | ch1 for 8-bit
+    // output through DHR8RD (uint16_t)
+
+    template<uint8_t SEL = 0>
+    static inline void enable_dual_trigger()
+    {
+        enable_trigger<1, SEL>();
+        enable_trigger<2, SEL>();
+    }
+
+    template<typename DMA, uint8_t DMACH, typename T>
+    static inline void enable_dual_dma(const T *source, uint16_t nelem)
+    {
+        static_assert(sizeof(T) == 4 || sizeof(T) == 2, "dual dac samples must be packed uint32_t (12-bit) or uint16_t (8-bit)");
+
+        volatile uint32_t& reg = sizeof(T) == 4 ? DAC().DHR12RD : DAC().DHR8RD;
+
+        DAC().CR |= dac_channel_traits<NO, 1>::CR_DMAEN;        // enable dac channel 1 dma
+        DAC().CR |= dac_channel_traits<NO, 1>::CR_DMAUDRIE;     // enable dac dma underrun interrupt
+        DMA::template disable<DMACH>();                                 // disable dma channel
+        DMA::template mem_to_periph<DMACH>(source, nelem, &reg);    // configure dma from memory
+        DMA::template request<DMACH, dac_channel_traits<NO, 1>::dma_request>(); // route dac request
+        DMA::template enable<DMACH>();                                  // enable dma channel
+        DAC().CR |= dac_channel_traits<NO, 1>::CR_EN                // enable both dac channels
+                 |  dac_channel_traits<NO, 2>::CR_EN
+                 ;
+        sys_tick::delay_us(8);                              // wait for voltage to settle
+    }
+
+    template<typename DMA, uint8_t DMACH>
+    static inline void disable_dual_dma()
+    {
+        DAC().CR &= ~dac_channel_traits<NO, 1>::CR_DMAEN;       // disable dac channel 1 dma
+        disable<1>();                                               // disable dac channel 1
+        disable<2>();                                               // disable dac channel 2
+        sys_tick::delay_us(500);                                // ensure miniumum wait before next enable
+        DMA::template abort<DMACH>();                               // stop dma on relevant dma channel
+        DAC().CR &= ~dac_channel_traits<NO, 1>::CR_DMAUDRIE;    // disable dac channel underrun interrupt
+    }
+
+    static constexpr uint32_t pack12(uint16_t ch1, uint16_t ch2)
+    {
+        return (static_cast<uint32_t>(ch2) << 16) | ch1;
+    }
+
+    static constexpr uint16_t pack8(uint8_t ch1, uint8_t ch2)
+    {
+        return (static_cast<uint16_t>(ch2) << 8) | ch1;
+    }
+
+    static inline void write_dual(uint16_t ch1, uint16_t ch2)
+    {
+        DAC().DHR12RD = pack12(ch1, ch2);
+    }
+
+#if defined(STM32G4)
+    // double data mode: each 32-bit dma transfer carries two 12-bit samples
+    // (first in bits 11:0, second in bits 27:16), halving the dma request rate
+    // for the 15 MSPS internal dacs; the channel must be disabled at this point
+
+    template<uint8_t CH, typename DMA, uint8_t DMACH>
+    static inline void enable_double_dma(const uint32_t *source, uint16_t nelem)
+    {
+        volatile uint32_t& reg = dac_channel_traits<NO, CH>::DHR12R();
+
+        DAC().MCR |= dac_channel_traits<NO, CH>::MCR_DMADOUBLE; // enable dma double data mode
+        DAC().CR |= dac_channel_traits<NO, CH>::CR_DMAEN;       // enable dac channel dma
+        DAC().CR |= dac_channel_traits<NO, CH>::CR_DMAUDRIE;    // enable dac dma underrun interrupt
+        DMA::template disable<DMACH>();                                 // disable dma channel
+        DMA::template mem_to_periph<DMACH>(source, nelem, &reg);    // configure dma from memory
+        DMA::template request<DMACH, dac_channel_traits<NO, CH>::dma_request>(); // route dac request
+        DMA::template enable<DMACH>();                                  // enable dma channel
+        enable<CH>();                                               // enable dac channel
+    }
+
+    static constexpr uint32_t pack_double(uint16_t first, uint16_t second)
+    {
+        return (static_cast<uint32_t>(second) << 16) | first;
+    }
+#endif
+
     template<uint8_t CH, typename DMA, uint8_t DMACH>
     static inline void disable_dma()
     {
@@ -153,6 +295,9 @@ struct dac_t
         sys_tick::delay_us(500);                                // ensure miniumum wait before next enable
         DMA::template abort<DMACH>();                               // stop dma on relevant dma channel
         DAC().CR &= ~dac_channel_traits<NO, CH>::CR_DMAUDRIE;   // disable dac channel underrun interrupt
+#if defined(STM32G4)
+        DAC().MCR &= ~dac_channel_traits<NO, CH>::MCR_DMADOUBLE;    // disable dma double data mode
+#endif
     }
 
     template<uint8_t CH, uint32_t RST, uint32_t INC>
@@ -165,6 +310,26 @@ struct dac_t
         DAC().CR |= dac_channel_traits<NO, CH>::template CR_WAVE<0x3>;          // sawtooth wave enable
     }
 
+    // triangle wave around DHR12R base value, amplitude 2^(AMP+1)-1 for AMP in 0..11
+
+    template<uint8_t CH, uint8_t AMP>
+    static inline void enable_triangle()
+    {
+        static_assert(AMP < 12, "triangle amplitude selector out of range");
+
+        DAC().CR &= ~(dac_channel_traits<NO, CH>::template CR_WAVE<0x3>         // clear wave selection
+                     | dac_channel_traits<NO, CH>::template CR_MAMP<0xf>);      // clear amplitude
+        DAC().CR |= dac_channel_traits<NO, CH>::template CR_WAVE<0x2>           // triangle wave enable
+                 |  dac_channel_traits<NO, CH>::template CR_MAMP<AMP>           // triangle amplitude
+                 ;
+    }
+
+    template<uint8_t CH>
+    static inline void disable_wave()
+    {
+        DAC().CR &= ~dac_channel_traits<NO, CH>::template CR_WAVE<0x3>;         // wave generation disable
+    }
+
     template<uint8_t CH, uint8_t SEL = 0>
     static inline void enable_trigger()
     {
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+
+namespace dds
+{
+
+//
+//  Direct digital synthesis with 32-bit phase accumulators and band-limited
+//  wavetables. Tables are generated at compile time by additive synthesis,
+//  one table per octave of harmonic content, so sample generation is integer
+//  only (table lookup plus linear interpolation) and runs on cores without an
+//  fpu. The table level is chosen from the phase increment such that no
+//  harmonic exceeds the nyquist frequency.
+//
+
+static constexpr uint8_t table_bits = 8;
+static constexpr uint16_t table_size = 1 << table_bits;
+static constexpr uint8_t max_levels = 7;                    // 64, 32, ..., 1 harmonics
+static constexpr uint16_t max_harmonics = 1 << (max_levels - 1);
+
+namespace internal
+{
+
+static constexpr double pi = 3.14159265358979323846;
+
+static constexpr double sin(double x)                       // compile-time only
+{
+    while (x > pi)
+        x -= 2 * pi;
+    while (x < -pi)
+        x += 2 * pi;
+
+    double x2 = x * x, term = x, sum = x;
+
+    for (int k = 1; k < 16; ++k)
+    {
+        term *= -x2 / ((2 * k) * (2 * k + 1));
+        sum += term;
+    }
+
+    return sum;
+}
+
+struct sine_basis_t
+{
+    constexpr sine_basis_t(): v()
+    {
+        for (uint16_t i = 0; i < table_size; ++i)
+            v[i] = sin(2 * pi * i / table_size);
+    }
+
+    double v[table_size];
+};
+
+static constexpr sine_basis_t sine_basis;
+
+template<typename SPECTRUM>
+struct wavetable_gen_t
+{
+    constexpr wavetable_gen_t(): v()
+    {
+        for (uint8_t l = 0; l < SPECTRUM::levels; ++l)
+        {
+            const uint16_t nh = SPECTRUM::levels > 1 ? max_harmonics >> l : 1;
+            double s[table_size] = {}, peak = 0;
+
+            for (uint16_t i = 0; i < table_size; ++i)
+            {
+                for (uint16_t h = 1; h <= nh; ++h)
+                    s[i] += SPECTRUM::harmonic(h) * sine_basis.v[(h * i) & (table_size - 1)];
+                if (s[i] > peak)
+                    peak = s[i];
+                else if (-s[i] > peak)
+                    peak = -s[i];
+            }
+
+            for (uint16_t i = 0; i < table_size; ++i)
+            {
+                double x = s[i] * 32767 / peak;
+
+                v[l][i] = static_cast<int16_t>(x < 0 ? x - 0.5 : x + 0.5);
+            }
+
+            v[l][table_size] = v[l][0];                     // guard for interpolation
+        }
+    }
+
+    int16_t v[SPECTRUM::levels][table_size + 1];
+};
+
+} // namespace internal
+
+//
+//  Harmonic spectra (sine series coefficients) for the standard waveforms.
+//
+
+struct sine
+{
+    static constexpr uint8_t levels = 1;
+    static constexpr double harmonic(uint16_t h) { return h == 1 ? 1. : 0.; }
+};
+
+struct sawtooth
+{
+    static constexpr uint8_t levels = max_levels;
+    static constexpr double harmonic(uint16_t h) { return (h & 1 ? 1. : -1.) / h; }
+};
+
+struct square
+{
+    static constexpr uint8_t levels = max_levels;
+    static constexpr double harmonic(uint16_t h) { return h & 1 ? 1. / h : 0.; }
+};
+
+struct triangle
+{
+    static constexpr uint8_t levels = max_levels;
+    static constexpr double harmonic(uint16_t h) { return h & 1 ? ((h >> 1) & 1 ? -1. : 1.) / (h * h) : 0.; }
+};
+
+template<typename SPECTRUM>
+struct wavetable_t
+{
+    static constexpr internal::wavetable_gen_t<SPECTRUM> table = {};
+
+    static inline uint8_t level(uint32_t dphi)              // band-limit for phase increment
+    {
+        uint8_t l = 0;
+
+        for (uint16_t nh = max_harmonics; l < SPECTRUM::levels - 1 && dphi > (1ul << 31) / nh; nh >>= 1)
+            ++l;
+        return l;
+    }
+
+    static inline int16_t lookup(uint8_t l, uint32_t phi)   // interpolated table value
+    {
+        const int16_t *p = table.v[l] + (phi >> (32 - table_bits));
+        int32_t frac = (phi >> (17 - table_bits)) & 0x7fff;
+
+        return p[0] + (((p[1] - p[0]) * frac) >> 15);
+    }
+};
+
+template<typename SPECTRUM, uint32_t SAMPLE_FREQ>
+class oscillator_t
+{
+public:
+    typedef wavetable_t<SPECTRUM> wavetable;
+
+    static constexpr uint32_t increment(uint32_t freq)      // phase increment for frequency in Hz
+    {
+        return (static_cast<uint64_t>(freq) << 32) / SAMPLE_FREQ;
+    }
+
+    void setup(uint32_t freq = 440)
+    {
+        m_phi = 0;
+        set_freq(freq);
+    }
+
+    void set_freq(uint32_t freq)
+    {
+        set_increment(increment(freq));
+    }
+
+    void set_increment(uint32_t dphi)
+    {
+        m_level = wavetable::level(dphi);
+        m_dphi = dphi;
+    }
+
+    uint32_t get_increment() const { return m_dphi; }
+
+    inline int16_t sample()
+    {
+        int16_t s = wavetable::lookup(m_level, m_phi);
+
+        m_phi += m_dphi;                                    // wraps around naturally
+        return s;
+    }
+
+    // render n samples as unsigned 12-bit dac values centered at mid-scale,
+    // scaled by the q15 amplitude gain
+
+    void render(uint16_t *dst, uint16_t n, int16_t gain = 0x7fff)
+    {
+        const uint8_t l = m_level;
+        const uint32_t dphi = m_dphi;
+        uint32_t phi = m_phi;
+
+        while (n--)
+        {
+            int32_t s = (wavetable::lookup(l, phi) * static_cast<int32_t>(gain)) >> 15;
+
+            *dst++ = static_cast<uint16_t>((s + 0x8000) >> 4);
+            phi += dphi;
+        }
+
+        m_phi = phi;
+    }
+
+private:
+    uint32_t            m_phi;
+    volatile uint32_t   m_dphi;
+    volatile uint8_t    m_level;
+};
+
+} // namespace dds
+
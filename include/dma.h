@@ -20,6 +20,11 @@ enum circular_mode
     , linear
     };
 
+enum increment_mode
+    { memory_increment
+    , memory_fixed                                  // e.g. dummy or discard word
+    };
+
 #if defined(HAVE_PERIPHERAL_DMAMUX)
 template<uint8_t NO, uint8_t CH> struct dmamux_traits {};
 
@@ -262,6 +267,21 @@ template<uint8_t NO> struct dma_channel_traits<NO, 8>
     static inline volatile uint32_t& CMAR() { return DMA().CMAR8; }
 };
 #elif defined(STM32G0)
+enum resource_t
+    { DMAMUX_REQ_G0 = 1, DMAMUX_REQ_G1 = 2, DMAMUX_REQ_G2 = 3, DMAMUX_REQ_G3 = 4, ADC = 5, AES_IN = 6
+    , AES_OUT = 7, DAC_CH1 = 8, DAC_CH2 = 9, I2C1_RX = 10, I2C1_TX = 11, I2C2_RX = 12, I2C2_TX = 13
+    , LPUART1_RX = 14, LPUART1_TX = 15, SPI1_RX = 16, SPI1_TX = 17, SPI2_RX = 18, SPI2_TX = 19
+    , TIM1_CH1 = 20, TIM1_CH2 = 21, TIM1_CH3 = 22, TIM1_CH4 = 23, TIM1_TRIG_COM = 24, TIM1_UP = 25
+    , TIM2_CH1 = 26, TIM2_CH2 = 27, TIM2_CH3 = 28, TIM2_CH4 = 29, TIM2_TRIG = 30, TIM2_UP = 31
+    , TIM3_CH1 = 32, TIM3_CH2 = 33, TIM3_CH3 = 34, TIM3_CH4 = 35, TIM3_TRIG = 36, TIM3_UP = 37
+    , TIM6_UP = 38, TIM7_UP = 39, TIM15_CH1 = 40, TIM15_CH2 = 41, TIM15_TRIG_COM = 42, TIM15_UP = 43
+    , TIM16_CH1 = 44, TIM16_COM = 45, TIM16_UP = 46, TIM17_CH1 = 47, TIM17_COM = 48, TIM17_UP = 49
+    , USART1_RX = 50, USART1_TX = 51, USART2_RX = 52, USART2_TX = 53, USART3_RX = 54, USART3_TX = 55
+    , USART4_RX = 56, USART4_TX = 57, UCPD1_RX = 58, UCPD1_TX = 59, UCPD2_RX = 60, UCPD2_TX = 61
+    };
+
+// N.B. the SVD numbers the G0 status and clear flags sequentially across channels
+
 template<uint8_t NO> struct dma_channel_traits<NO, 1>
 {
     typedef typename dma_traits<NO>::T _;
@@ -303,8 +323,112 @@ template<uint8_t NO> struct dma_channel_traits<NO, 2>
     static inline volatile uint32_t& CPAR() { return DMA().CPAR2; }
     static inline volatile uint32_t& CMAR() { return DMA().CMAR2; }
 };
-#elif defined(STM32F0)
-// TODO: Complete this section
+
+template<uint8_t NO> struct dma_channel_traits<NO, 3>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::ISR_TEIF11;
+    static constexpr uint32_t ISR_HTIF = _::ISR_HTIF10;
+    static constexpr uint32_t ISR_TCIF = _::ISR_TCIF9;
+    static constexpr uint32_t ISR_GIF = _::ISR_GIF8;
+
+    static constexpr uint32_t IFCR_TEIF = _::IFCR_CTEIF11;
+    static constexpr uint32_t IFCR_HTIF = _::IFCR_CHTIF10;
+    static constexpr uint32_t IFCR_TCIF = _::IFCR_CTCIF9;
+    static constexpr uint32_t IFCR_GIF = _::IFCR_CGIF8;
+
+    static inline volatile uint32_t& CCR() { return DMA().CCR3; }
+    static inline volatile uint32_t& CNDTR() { return DMA().CNDTR3; }
+    static inline volatile uint32_t& CPAR() { return DMA().CPAR3; }
+    static inline volatile uint32_t& CMAR() { return DMA().CMAR3; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 4>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::ISR_TEIF15;
+    static constexpr uint32_t ISR_HTIF = _::ISR_HTIF14;
+    static constexpr uint32_t ISR_TCIF = _::ISR_TCIF13;
+    static constexpr uint32_t ISR_GIF = _::ISR_GIF12;
+
+    static constexpr uint32_t IFCR_TEIF = _::IFCR_CTEIF15;
+    static constexpr uint32_t IFCR_HTIF = _::IFCR_CHTIF14;
+    static constexpr uint32_t IFCR_TCIF = _::IFCR_CTCIF13;
+    static constexpr uint32_t IFCR_GIF = _::IFCR_CGIF12;
+
+    static inline volatile uint32_t& CCR() { return DMA().CCR4; }
+    static inline volatile uint32_t& CNDTR() { return DMA().CNDTR4; }
+    static inline volatile uint32_t& CPAR() { return DMA().CPAR4; }
+    static inline volatile uint32_t& CMAR() { return DMA().CMAR4; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 5>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::ISR_TEIF19;
+    static constexpr uint32_t ISR_HTIF = _::ISR_HTIF18;
+    static constexpr uint32_t ISR_TCIF = _::ISR_TCIF17;
+    static constexpr uint32_t ISR_GIF = _::ISR_GIF16;
+
+    static constexpr uint32_t IFCR_TEIF = _::IFCR_CTEIF19;
+    static constexpr uint32_t IFCR_HTIF = _::IFCR_CHTIF18;
+    static constexpr uint32_t IFCR_TCIF = _::IFCR_CTCIF17;
+    static constexpr uint32_t IFCR_GIF = _::IFCR_CGIF16;
+
+    static inline volatile uint32_t& CCR() { return DMA().CCR5; }
+    static inline volatile uint32_t& CNDTR() { return DMA().CNDTR5; }
+    static inline volatile uint32_t& CPAR() { return DMA().CPAR5; }
+    static inline volatile uint32_t& CMAR() { return DMA().CMAR5; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 6>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::ISR_TEIF23;
+    static constexpr uint32_t ISR_HTIF = _::ISR_HTIF22;
+    static constexpr uint32_t ISR_TCIF = _::ISR_TCIF21;
+    static constexpr uint32_t ISR_GIF = _::ISR_GIF20;
+
+    static constexpr uint32_t IFCR_TEIF = _::IFCR_CTEIF23;
+    static constexpr uint32_t IFCR_HTIF = _::IFCR_CHTIF22;
+    static constexpr uint32_t IFCR_TCIF = _::IFCR_CTCIF21;
+    static constexpr uint32_t IFCR_GIF = _::IFCR_CGIF20;
+
+    static inline volatile uint32_t& CCR() { return DMA().CCR6; }
+    static inline volatile uint32_t& CNDTR() { return DMA().CNDTR6; }
+    static inline volatile uint32_t& CPAR() { return DMA().CPAR6; }
+    static inline volatile uint32_t& CMAR() { return DMA().CMAR6; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 7>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::ISR_TEIF27;
+    static constexpr uint32_t ISR_HTIF = _::ISR_HTIF26;
+    static constexpr uint32_t ISR_TCIF = _::ISR_TCIF25;
+    static constexpr uint32_t ISR_GIF = _::ISR_GIF24;
+
+    static constexpr uint32_t IFCR_TEIF = _::IFCR_CTEIF27;
+    static constexpr uint32_t IFCR_HTIF = _::IFCR_CHTIF26;
+    static constexpr uint32_t IFCR_TCIF = _::IFCR_CTCIF25;
+    static constexpr uint32_t IFCR_GIF = _::IFCR_CGIF24;
+
+    static inline volatile uint32_t& CCR() { return DMA().CCR7; }
+    static inline volatile uint32_t& CNDTR() { return DMA().CNDTR7; }
+    static inline volatile uint32_t& CPAR() { return DMA().CPAR7; }
+    static inline volatile uint32_t& CMAR() { return DMA().CMAR7; }
+};
+#elif defined(STM32F0) || defined(STM32F1)
 template<uint8_t NO> struct dma_channel_traits<NO, 1>
 {
     typedef typename dma_traits<NO>::T _;
@@ -326,6 +450,69 @@ template<uint8_t NO> struct dma_channel_traits<NO, 1>
     static inline volatile uint32_t& CMAR() { return DMA().CMAR1; }
 };
 
+template<uint8_t NO> struct dma_channel_traits<NO, 2>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::ISR_TEIF2;
+    static constexpr uint32_t ISR_HTIF = _::ISR_HTIF2;
+    static constexpr uint32_t ISR_TCIF = _::ISR_TCIF2;
+    static constexpr uint32_t ISR_GIF = _::ISR_GIF2;
+
+    static constexpr uint32_t IFCR_TEIF = _::IFCR_CTEIF2;
+    static constexpr uint32_t IFCR_HTIF = _::IFCR_CHTIF2;
+    static constexpr uint32_t IFCR_TCIF = _::IFCR_CTCIF2;
+    static constexpr uint32_t IFCR_GIF = _::IFCR_CGIF2;
+
+    static inline volatile uint32_t& CCR() { return DMA().CCR2; }
+    static inline volatile uint32_t& CNDTR() { return DMA().CNDTR2; }
+    static inline volatile uint32_t& CPAR() { return DMA().CPAR2; }
+    static inline volatile uint32_t& CMAR() { return DMA().CMAR2; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 3>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::ISR_TEIF3;
+    static constexpr uint32_t ISR_HTIF = _::ISR_HTIF3;
+    static constexpr uint32_t ISR_TCIF = _::ISR_TCIF3;
+    static constexpr uint32_t ISR_GIF = _::ISR_GIF3;
+
+    static constexpr uint32_t IFCR_TEIF = _::IFCR_CTEIF3;
+    static constexpr uint32_t IFCR_HTIF = _::IFCR_CHTIF3;
+    static constexpr uint32_t IFCR_TCIF = _::IFCR_CTCIF3;
+    static constexpr uint32_t IFCR_GIF = _::IFCR_CGIF3;
+
+    static inline volatile uint32_t& CCR() { return DMA().CCR3; }
+    static inline volatile uint32_t& CNDTR() { return DMA().CNDTR3; }
+    static inline volatile uint32_t& CPAR() { return DMA().CPAR3; }
+    static inline volatile uint32_t& CMAR() { return DMA().CMAR3; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 4>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::ISR_TEIF4;
+    static constexpr uint32_t ISR_HTIF = _::ISR_HTIF4;
+    static constexpr uint32_t ISR_TCIF = _::ISR_TCIF4;
+    static constexpr uint32_t ISR_GIF = _::ISR_GIF4;
+
+    static constexpr uint32_t IFCR_TEIF = _::IFCR_CTEIF4;
+    static constexpr uint32_t IFCR_HTIF = _::IFCR_CHTIF4;
+    static constexpr uint32_t IFCR_TCIF = _::IFCR_CTCIF4;
+    static constexpr uint32_t IFCR_GIF = _::IFCR_CGIF4;
+
+    static inline volatile uint32_t& CCR() { return DMA().CCR4; }
+    static inline volatile uint32_t& CNDTR() { return DMA().CNDTR4; }
+    static inline volatile uint32_t& CPAR() { return DMA().CPAR4; }
+    static inline volatile uint32_t& CMAR() { return DMA().CMAR4; }
+};
+
 template<uint8_t NO> struct dma_channel_traits<NO, 5>
 {
     typedef typename dma_traits<NO>::T _;
@@ -346,6 +533,243 @@ template<uint8_t NO> struct dma_channel_traits<NO, 5>
     static inline volatile uint32_t& CPAR() { return DMA().CPAR5; }
     static inline volatile uint32_t& CMAR() { return DMA().CMAR5; }
 };
+
+template<uint8_t NO> struct dma_channel_traits<NO, 6>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::ISR_TEIF6;
+    static constexpr uint32_t ISR_HTIF = _::ISR_HTIF6;
+    static constexpr uint32_t ISR_TCIF = _::ISR_TCIF6;
+    static constexpr uint32_t ISR_GIF = _::ISR_GIF6;
+
+    static constexpr uint32_t IFCR_TEIF = _::IFCR_CTEIF6;
+    static constexpr uint32_t IFCR_HTIF = _::IFCR_CHTIF6;
+    static constexpr uint32_t IFCR_TCIF = _::IFCR_CTCIF6;
+    static constexpr uint32_t IFCR_GIF = _::IFCR_CGIF6;
+
+    static inline volatile uint32_t& CCR() { return DMA().CCR6; }
+    static inline volatile uint32_t& CNDTR() { return DMA().CNDTR6; }
+    static inline volatile uint32_t& CPAR() { return DMA().CPAR6; }
+    static inline volatile uint32_t& CMAR() { return DMA().CMAR6; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 7>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::ISR_TEIF7;
+    static constexpr uint32_t ISR_HTIF = _::ISR_HTIF7;
+    static constexpr uint32_t ISR_TCIF = _::ISR_TCIF7;
+    static constexpr uint32_t ISR_GIF = _::ISR_GIF7;
+
+    static constexpr uint32_t IFCR_TEIF = _::IFCR_CTEIF7;
+    static constexpr uint32_t IFCR_HTIF = _::IFCR_CHTIF7;
+    static constexpr uint32_t IFCR_TCIF = _::IFCR_CTCIF7;
+    static constexpr uint32_t IFCR_GIF = _::IFCR_CGIF7;
+
+    static inline volatile uint32_t& CCR() { return DMA().CCR7; }
+    static inline volatile uint32_t& CNDTR() { return DMA().CNDTR7; }
+    static inline volatile uint32_t& CPAR() { return DMA().CPAR7; }
+    static inline volatile uint32_t& CMAR() { return DMA().CMAR7; }
+};
+#elif defined(STM32F4) || defined(STM32F7)
+// N.B. stream controllers: CH denotes the stream number [0..7] and requests
+// are routed to a stream by the channel selection field (see dma_t::request)
+
+template<uint8_t NO> struct dma_channel_traits<NO, 0>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::LISR_TEIF0;
+    static constexpr uint32_t ISR_HTIF = _::LISR_HTIF0;
+    static constexpr uint32_t ISR_TCIF = _::LISR_TCIF0;
+    static constexpr uint32_t ISR_GIF = _::LISR_TEIF0 | _::LISR_HTIF0 | _::LISR_TCIF0 | _::LISR_DMEIF0 | _::LISR_FEIF0;
+
+    static constexpr uint32_t IFCR_TEIF = _::LIFCR_CTEIF0;
+    static constexpr uint32_t IFCR_HTIF = _::LIFCR_CHTIF0;
+    static constexpr uint32_t IFCR_TCIF = _::LIFCR_CTCIF0;
+    static constexpr uint32_t IFCR_GIF = _::LIFCR_CTEIF0 | _::LIFCR_CHTIF0 | _::LIFCR_CTCIF0 | _::LIFCR_CDMEIF0 | _::LIFCR_CFEIF0;
+
+    static inline volatile uint32_t& ISR() { return DMA().LISR; }
+    static inline volatile uint32_t& IFCR() { return DMA().LIFCR; }
+    static inline volatile uint32_t& CCR() { return DMA().S0CR; }
+    static inline volatile uint32_t& CNDTR() { return DMA().S0NDTR; }
+    static inline volatile uint32_t& CPAR() { return DMA().S0PAR; }
+    static inline volatile uint32_t& CMAR() { return DMA().S0M0AR; }
+    static inline volatile uint32_t& CFCR() { return DMA().S0FCR; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 1>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::LISR_TEIF1;
+    static constexpr uint32_t ISR_HTIF = _::LISR_HTIF1;
+    static constexpr uint32_t ISR_TCIF = _::LISR_TCIF1;
+    static constexpr uint32_t ISR_GIF = _::LISR_TEIF1 | _::LISR_HTIF1 | _::LISR_TCIF1 | _::LISR_DMEIF1 | _::LISR_FEIF1;
+
+    static constexpr uint32_t IFCR_TEIF = _::LIFCR_CTEIF1;
+    static constexpr uint32_t IFCR_HTIF = _::LIFCR_CHTIF1;
+    static constexpr uint32_t IFCR_TCIF = _::LIFCR_CTCIF1;
+    static constexpr uint32_t IFCR_GIF = _::LIFCR_CTEIF1 | _::LIFCR_CHTIF1 | _::LIFCR_CTCIF1 | _::LIFCR_CDMEIF1 | _::LIFCR_CFEIF1;
+
+    static inline volatile uint32_t& ISR() { return DMA().LISR; }
+    static inline volatile uint32_t& IFCR() { return DMA().LIFCR; }
+    static inline volatile uint32_t& CCR() { return DMA().S1CR; }
+    static inline volatile uint32_t& CNDTR() { return DMA().S1NDTR; }
+    static inline volatile uint32_t& CPAR() { return DMA().S1PAR; }
+    static inline volatile uint32_t& CMAR() { return DMA().S1M0AR; }
+    static inline volatile uint32_t& CFCR() { return DMA().S1FCR; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 2>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::LISR_TEIF2;
+    static constexpr uint32_t ISR_HTIF = _::LISR_HTIF2;
+    static constexpr uint32_t ISR_TCIF = _::LISR_TCIF2;
+    static constexpr uint32_t ISR_GIF = _::LISR_TEIF2 | _::LISR_HTIF2 | _::LISR_TCIF2 | _::LISR_DMEIF2 | _::LISR_FEIF2;
+
+    static constexpr uint32_t IFCR_TEIF = _::LIFCR_CTEIF2;
+    static constexpr uint32_t IFCR_HTIF = _::LIFCR_CHTIF2;
+    static constexpr uint32_t IFCR_TCIF = _::LIFCR_CTCIF2;
+    static constexpr uint32_t IFCR_GIF = _::LIFCR_CTEIF2 | _::LIFCR_CHTIF2 | _::LIFCR_CTCIF2 | _::LIFCR_CDMEIF2 | _::LIFCR_CFEIF2;
+
+    static inline volatile uint32_t& ISR() { return DMA().LISR; }
+    static inline volatile uint32_t& IFCR() { return DMA().LIFCR; }
+    static inline volatile uint32_t& CCR() { return DMA().S2CR; }
+    static inline volatile uint32_t& CNDTR() { return DMA().S2NDTR; }
+    static inline volatile uint32_t& CPAR() { return DMA().S2PAR; }
+    static inline volatile uint32_t& CMAR() { return DMA().S2M0AR; }
+    static inline volatile uint32_t& CFCR() { return DMA().S2FCR; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 3>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::LISR_TEIF3;
+    static constexpr uint32_t ISR_HTIF = _::LISR_HTIF3;
+    static constexpr uint32_t ISR_TCIF = _::LISR_TCIF3;
+    static constexpr uint32_t ISR_GIF = _::LISR_TEIF3 | _::LISR_HTIF3 | _::LISR_TCIF3 | _::LISR_DMEIF3 | _::LISR_FEIF3;
+
+    static constexpr uint32_t IFCR_TEIF = _::LIFCR_CTEIF3;
+    static constexpr uint32_t IFCR_HTIF = _::LIFCR_CHTIF3;
+    static constexpr uint32_t IFCR_TCIF = _::LIFCR_CTCIF3;
+    static constexpr uint32_t IFCR_GIF = _::LIFCR_CTEIF3 | _::LIFCR_CHTIF3 | _::LIFCR_CTCIF3 | _::LIFCR_CDMEIF3 | _::LIFCR_CFEIF3;
+
+    static inline volatile uint32_t& ISR() { return DMA().LISR; }
+    static inline volatile uint32_t& IFCR() { return DMA().LIFCR; }
+    static inline volatile uint32_t& CCR() { return DMA().S3CR; }
+    static inline volatile uint32_t& CNDTR() { return DMA().S3NDTR; }
+    static inline volatile uint32_t& CPAR() { return DMA().S3PAR; }
+    static inline volatile uint32_t& CMAR() { return DMA().S3M0AR; }
+    static inline volatile uint32_t& CFCR() { return DMA().S3FCR; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 4>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::HISR_TEIF4;
+    static constexpr uint32_t ISR_HTIF = _::HISR_HTIF4;
+    static constexpr uint32_t ISR_TCIF = _::HISR_TCIF4;
+    static constexpr uint32_t ISR_GIF = _::HISR_TEIF4 | _::HISR_HTIF4 | _::HISR_TCIF4 | _::HISR_DMEIF4 | _::HISR_FEIF4;
+
+    static constexpr uint32_t IFCR_TEIF = _::HIFCR_CTEIF4;
+    static constexpr uint32_t IFCR_HTIF = _::HIFCR_CHTIF4;
+    static constexpr uint32_t IFCR_TCIF = _::HIFCR_CTCIF4;
+    static constexpr uint32_t IFCR_GIF = _::HIFCR_CTEIF4 | _::HIFCR_CHTIF4 | _::HIFCR_CTCIF4 | _::HIFCR_CDMEIF4 | _::HIFCR_CFEIF4;
+
+    static inline volatile uint32_t& ISR() { return DMA().HISR; }
+    static inline volatile uint32_t& IFCR() { return DMA().HIFCR; }
+    static inline volatile uint32_t& CCR() { return DMA().S4CR; }
+    static inline volatile uint32_t& CNDTR() { return DMA().S4NDTR; }
+    static inline volatile uint32_t& CPAR() { return DMA().S4PAR; }
+    static inline volatile uint32_t& CMAR() { return DMA().S4M0AR; }
+    static inline volatile uint32_t& CFCR() { return DMA().S4FCR; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 5>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::HISR_TEIF5;
+    static constexpr uint32_t ISR_HTIF = _::HISR_HTIF5;
+    static constexpr uint32_t ISR_TCIF = _::HISR_TCIF5;
+    static constexpr uint32_t ISR_GIF = _::HISR_TEIF5 | _::HISR_HTIF5 | _::HISR_TCIF5 | _::HISR_DMEIF5 | _::HISR_FEIF5;
+
+    static constexpr uint32_t IFCR_TEIF = _::HIFCR_CTEIF5;
+    static constexpr uint32_t IFCR_HTIF = _::HIFCR_CHTIF5;
+    static constexpr uint32_t IFCR_TCIF = _::HIFCR_CTCIF5;
+    static constexpr uint32_t IFCR_GIF = _::HIFCR_CTEIF5 | _::HIFCR_CHTIF5 | _::HIFCR_CTCIF5 | _::HIFCR_CDMEIF5 | _::HIFCR_CFEIF5;
+
+    static inline volatile uint32_t& ISR() { return DMA().HISR; }
+    static inline volatile uint32_t& IFCR() { return DMA().HIFCR; }
+    static inline volatile uint32_t& CCR() { return DMA().S5CR; }
+    static inline volatile uint32_t& CNDTR() { return DMA().S5NDTR; }
+    static inline volatile uint32_t& CPAR() { return DMA().S5PAR; }
+    static inline volatile uint32_t& CMAR() { return DMA().S5M0AR; }
+    static inline volatile uint32_t& CFCR() { return DMA().S5FCR; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 6>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::HISR_TEIF6;
+    static constexpr uint32_t ISR_HTIF = _::HISR_HTIF6;
+    static constexpr uint32_t ISR_TCIF = _::HISR_TCIF6;
+    static constexpr uint32_t ISR_GIF = _::HISR_TEIF6 | _::HISR_HTIF6 | _::HISR_TCIF6 | _::HISR_DMEIF6 | _::HISR_FEIF6;
+
+    static constexpr uint32_t IFCR_TEIF = _::HIFCR_CTEIF6;
+    static constexpr uint32_t IFCR_HTIF = _::HIFCR_CHTIF6;
+    static constexpr uint32_t IFCR_TCIF = _::HIFCR_CTCIF6;
+    static constexpr uint32_t IFCR_GIF = _::HIFCR_CTEIF6 | _::HIFCR_CHTIF6 | _::HIFCR_CTCIF6 | _::HIFCR_CDMEIF6 | _::HIFCR_CFEIF6;
+
+    static inline volatile uint32_t& ISR() { return DMA().HISR; }
+    static inline volatile uint32_t& IFCR() { return DMA().HIFCR; }
+    static inline volatile uint32_t& CCR() { return DMA().S6CR; }
+    static inline volatile uint32_t& CNDTR() { return DMA().S6NDTR; }
+    static inline volatile uint32_t& CPAR() { return DMA().S6PAR; }
+    static inline volatile uint32_t& CMAR() { return DMA().S6M0AR; }
+    static inline volatile uint32_t& CFCR() { return DMA().S6FCR; }
+};
+
+template<uint8_t NO> struct dma_channel_traits<NO, 7>
+{
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static constexpr uint32_t ISR_TEIF = _::HISR_TEIF7;
+    static constexpr uint32_t ISR_HTIF = _::HISR_HTIF7;
+    static constexpr uint32_t ISR_TCIF = _::HISR_TCIF7;
+    static constexpr uint32_t ISR_GIF = _::HISR_TEIF7 | _::HISR_HTIF7 | _::HISR_TCIF7 | _::HISR_DMEIF7 | _::HISR_FEIF7;
+
+    static constexpr uint32_t IFCR_TEIF = _::HIFCR_CTEIF7;
+    static constexpr uint32_t IFCR_HTIF = _::HIFCR_CHTIF7;
+    static constexpr uint32_t IFCR_TCIF = _::HIFCR_CTCIF7;
+    static constexpr uint32_t IFCR_GIF = _::HIFCR_CTEIF7 | _::HIFCR_CHTIF7 | _::HIFCR_CTCIF7 | _::HIFCR_CDMEIF7 | _::HIFCR_CFEIF7;
+
+    static inline volatile uint32_t& ISR() { return DMA().HISR; }
+    static inline volatile uint32_t& IFCR() { return DMA().HIFCR; }
+    static inline volatile uint32_t& CCR() { return DMA().S7CR; }
+    static inline volatile uint32_t& CNDTR() { return DMA().S7NDTR; }
+    static inline volatile uint32_t& CPAR() { return DMA().S7PAR; }
+    static inline volatile uint32_t& CMAR() { return DMA().S7M0AR; }
+    static inline volatile uint32_t& CFCR() { return DMA().S7FCR; }
+};
 #endif
 
 template<uint8_t W> struct dma_size_bits {};
@@ -357,6 +781,136 @@ template<> struct dma_size_bits<4> { static constexpr uint32_t BITS = 0x2; };
 template<typename T>
 static constexpr uint32_t dma_type_size() { return dma_size_bits<sizeof(T)>::BITS; }
 
+#if defined(STM32F4) || defined(STM32F7)
+template<uint8_t NO>
+struct dma_t
+{
+    static constexpr uint8_t INST = NO;
+    typedef typename dma_traits<NO>::T _;
+    static inline typename dma_traits<NO>::T& DMA() { return dma_traits<NO>::DMA(); }
+
+    static void setup()
+    {
+        device::peripheral_traits<_>::enable();                 // enable dma clock
+    }
+
+    // N.B. in direct mode the stream transfers items of peripheral size, so
+    // peripheral and memory sizes are both taken from the memory item type
+
+    template<uint8_t CH, typename T, uint32_t PERIPH_REG_SIZE = dma_type_size<uint32_t>(), circular_mode CIRC_MODE = circular, increment_mode INC_MODE = memory_increment>
+    static inline void periph_to_mem(volatile uint32_t *source, volatile T *dest, uint16_t nelem)
+    {
+        typedef dma_channel_traits<NO, CH> __;
+
+        clear_interrupt_flags<CH>();                                    // clear all interrupt flags
+        __::CNDTR() = nelem;                                            // set number of data elements
+        __::CPAR() = reinterpret_cast<uint32_t>(source);
+        __::CMAR() = reinterpret_cast<uint32_t>(dest);
+        __::CFCR() = _::S0FCR_RESET_VALUE;                              // direct mode
+
+        __::CCR() = _::S0CR_RESET_VALUE                                 // reset stream configuration register
+                  | _::template S0CR_DIR<0x0>                           // direction peripheral to memory
+                  | (INC_MODE == memory_increment ? _::S0CR_MINC : 0)   // set memory increment mode
+                  | (CIRC_MODE == circular ? _::S0CR_CIRC : 0)          // use circular mode
+                  | _::template S0CR_MSIZE<dma_type_size<T>()>          // set memory item size
+                  | _::template S0CR_PSIZE<dma_type_size<T>()>          // set peripheral item size
+                  ;
+    }
+
+    template<uint8_t CH, typename T, uint32_t PERIPH_REG_SIZE = dma_type_size<uint32_t>(), circular_mode CIRC_MODE = circular, increment_mode INC_MODE = memory_increment>
+    static inline void mem_to_periph(const T *source, uint16_t nelem, volatile uint32_t *dest)
+    {
+        typedef dma_channel_traits<NO, CH> __;
+
+        clear_interrupt_flags<CH>();                                    // clear all interrupt flags
+        __::CNDTR() = nelem;                                            // set number of data elements
+        __::CPAR() = reinterpret_cast<uint32_t>(dest);
+        __::CMAR() = reinterpret_cast<uint32_t>(source);
+        __::CFCR() = _::S0FCR_RESET_VALUE;                              // direct mode
+
+        __::CCR() = _::S0CR_RESET_VALUE                                 // reset stream configuration register
+                  | _::template S0CR_DIR<0x1>                           // direction memory to peripheral
+                  | (INC_MODE == memory_increment ? _::S0CR_MINC : 0)   // set memory increment mode
+                  | (CIRC_MODE == circular ? _::S0CR_CIRC : 0)          // use circular mode
+                  | _::template S0CR_MSIZE<dma_type_size<T>()>          // set memory item size
+                  | _::template S0CR_PSIZE<dma_type_size<T>()>          // set peripheral item size
+                  ;
+    }
+
+    template<uint8_t CH, uint8_t REQ>
+    static inline void request()
+    {
+        dma_channel_traits<NO, CH>::CCR() |= _::template S0CR_CHSEL<REQ>;  // route request to stream
+    }
+
+    template<uint8_t CH, uint8_t PL>
+    static inline void priority()                               // 0 = low ... 3 = very high
+    {
+        dma_channel_traits<NO, CH>::CCR() &= ~_::template S0CR_PL<0x3>;
+        dma_channel_traits<NO, CH>::CCR() |= _::template S0CR_PL<PL>;
+    }
+
+    template<uint8_t CH, bool HALF = false>
+    static inline void enable_interrupt()
+    {
+        dma_channel_traits<NO, CH>::CCR() |= _::S0CR_TEIE               // interrupt on transfer error
+                                          |  _::S0CR_TCIE               // interrupt on transfer complete
+                                          |  (HALF ? _::S0CR_HTIE : 0)  // interrupt on half transfer
+                                          ;
+    }
+
+    template<uint8_t CH>
+    static inline void disable_interrupt()
+    {
+        dma_channel_traits<NO, CH>::CCR() &= ~(_::S0CR_TEIE | _::S0CR_HTIE | _::S0CR_TCIE);
+    }
+
+    template<uint8_t CH>
+    static inline uint32_t interrupt_status()
+    {
+        uint32_t x = dma_channel_traits<NO, CH>::ISR();
+
+        return ((x & dma_channel_traits<NO, CH>::ISR_GIF)  ? dma_global_interrupt  : 0)
+             | ((x & dma_channel_traits<NO, CH>::ISR_TCIF) ? dma_transfer_complete : 0)
+             | ((x & dma_channel_traits<NO, CH>::ISR_HTIF) ? dma_half_transfer     : 0)
+             | ((x & dma_channel_traits<NO, CH>::ISR_TEIF) ? dma_transfer_error    : 0)
+             ;
+    }
+
+    template<uint8_t CH>
+    static inline void clear_interrupt_flags()
+    {
+        dma_channel_traits<NO, CH>::IFCR() = dma_channel_traits<NO, CH>::IFCR_GIF;  // clear all stream flags
+    }
+
+    template<uint8_t CH>
+    static inline void enable()
+    {
+        dma_channel_traits<NO, CH>::CCR() |= _::S0CR_EN;        // enable dma stream
+    }
+
+    template<uint8_t CH>
+    static inline void disable()
+    {
+        dma_channel_traits<NO, CH>::CCR() &= ~_::S0CR_EN;       // disable dma stream
+        while (dma_channel_traits<NO, CH>::CCR() & _::S0CR_EN); // wait for ongoing transfer to end
+    }
+
+    template<uint8_t CH>
+    static inline uint16_t remaining()
+    {
+        return dma_channel_traits<NO, CH>::CNDTR();             // data elements left to transfer
+    }
+
+    template<uint8_t CH>
+    static inline void abort()
+    {
+        disable_interrupt<CH>();                                // disable dma stream interrupts
+        disable<CH>();                                          // disable dma stream
+        clear_interrupt_flags<CH>();                            // clear all interrupt flags
+    }
+};
+#else
 template<uint8_t NO>
 struct dma_t
 {
@@ -377,7 +931,7 @@ struct dma_t
         device::peripheral_traits<_>::enable();                 // enable dma clock
     }
 
-    template<uint8_t CH, typename T>
+    template<uint8_t CH, typename T, uint32_t PERIPH_REG_SIZE = dma_type_size<uint32_t>(), circular_mode CIRC_MODE = circular, increment_mode INC_MODE = memory_increment>
     static inline void periph_to_mem(volatile uint32_t *source, volatile T *dest, uint16_t nelem)
     {
         typedef dma_channel_traits<NO, CH> __;
@@ -391,14 +945,14 @@ struct dma_t
         __::CMAR() = reinterpret_cast<uint32_t>(dest);
 
         __::CCR() = _::CCR1_RESET_VALUE                                 // reset channel configuration register
-                  | _::CCR1_MINC                                        // set memory increment mode
-                  | _::CCR1_CIRC                                        // use circular mode
+                  | (INC_MODE == memory_increment ? _::CCR1_MINC : 0)   // set memory increment mode
+                  | (CIRC_MODE == circular ? _::CCR1_CIRC : 0)          // use circular mode
                   | _::template CCR1_MSIZE<dma_type_size<T>()>          // set memory item size
-                  | _::template CCR1_PSIZE<dma_type_size<uint32_t>()>   // set peripheral register size to 32-bits
+                  | _::template CCR1_PSIZE<PERIPH_REG_SIZE>             // set peripheral register size
                   ;
     }
 
-    template<uint8_t CH, typename T, uint32_t PERIPH_REG_SIZE = dma_type_size<uint32_t>(), circular_mode CIRC_MODE = circular>
+    template<uint8_t CH, typename T, uint32_t PERIPH_REG_SIZE = dma_type_size<uint32_t>(), circular_mode CIRC_MODE = circular, increment_mode INC_MODE = memory_increment>
     static inline void mem_to_periph(const T *source, uint16_t nelem, volatile uint32_t *dest)
     {
         typedef dma_channel_traits<NO, CH> __;
@@ -413,13 +967,28 @@ struct dma_t
 
         __::CCR() = _::CCR1_RESET_VALUE                                 // reset channel configuration register
                   | _::CCR1_DIR                                         // direction read from memory, write periphal
-                  | _::CCR1_MINC                                        // set memory increment mode
+                  | (INC_MODE == memory_increment ? _::CCR1_MINC : 0)   // set memory increment mode
                   | (CIRC_MODE == circular ? _::CCR1_CIRC : 0)          // use circular mode
                   | _::template CCR1_MSIZE<dma_type_size<T>()>          // set memory item size
                   | _::template CCR1_PSIZE<PERIPH_REG_SIZE>             // set peripheral register size
                   ;
     }
 
+    template<uint8_t CH, uint8_t REQ>
+    static inline void request()
+    {
+#if defined(HAVE_PERIPHERAL_DMAMUX)
+        dmamux_traits<NO, CH>::CCR() = MUX::template C0CR_DMAREQ_ID<REQ>;    // route request to channel
+#endif // HAVE_PERIPHERAL_DMAMUX
+    }
+
+    template<uint8_t CH, uint8_t PL>
+    static inline void priority()                               // 0 = low ... 3 = very high
+    {
+        dma_channel_traits<NO, CH>::CCR() &= ~_::template CCR1_PL<0x3>;
+        dma_channel_traits<NO, CH>::CCR() |= _::template CCR1_PL<PL>;
+    }
+
     template<uint8_t CH, bool HALF = false>
     static inline void enable_interrupt()
     {
@@ -465,6 +1034,12 @@ struct dma_t
         dma_channel_traits<NO, CH>::CCR() &= ~_::CCR1_EN;       // disable dma channel
     }
 
+    template<uint8_t CH>
+    static inline uint16_t remaining()
+    {
+        return dma_channel_traits<NO, CH>::CNDTR();             // data elements left to transfer
+    }
+
     template<uint8_t CH>
     static inline void abort()
     {
@@ -479,6 +1054,7 @@ struct dma_t
 #endif // HAVE_PERIPHERAL_DMAMUX
     }
 };
+#endif
 
 } // namespace dma
 
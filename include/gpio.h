@@ -298,10 +298,18 @@ public:
     static inline void setup()
     {
         device::peripheral_traits<typename port_traits<pin_port(PIN)>::gpio_t>::enable();
+#if defined(STM32F103)
+        volatile uint32_t& CR = pin::bit_pos < 8 ? pin::gpio().CRL : pin::gpio().CRH;
+        constexpr uint8_t shift = (pin::bit_pos < 8 ? pin::bit_pos : (pin::bit_pos - 8)) << 2;
+
+        static_assert(input_type == floating, "only floating mode allowed for analog pins");
+        CR &= ~(0xf << shift);                      // analog input mode
+#else
         pin::gpio().MODER |= 0x3 << (pin::bit_pos*2);
         static_assert(input_type != pull_up, "only floating or pull-down modes allowed for analog pins");
         if (input_type != floating)
             pin::gpio().PUPDR |= input_type << (pin::bit_pos*2);
+#endif
     }
 
 private:
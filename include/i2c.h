@@ -1,6 +1,7 @@
 #pragma once
 
 #include <gpio.h>
+#include "dma.h"
 
 namespace hal
 {
@@ -17,6 +18,25 @@ template<> struct i2c_traits<1>
     static inline T& I2C() { return device::I2C1; }
     static const gpio::internal::alternate_function_t scl = gpio::internal::I2C1_SCL;
     static const gpio::internal::alternate_function_t sda = gpio::internal::I2C1_SDA;
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_tx_request = dma::I2C1_TX;
+    static const uint8_t dma_rx_request = dma::I2C1_RX;
+#elif defined(STM32F7)
+    static const uint8_t dma_tx_request = 1;                // dma1 stream 6 or 7
+    static const uint8_t dma_rx_request = 1;                // dma1 stream 0 or 5
+#else
+    static const uint8_t dma_tx_request = 0;                // fixed dma mapping
+    static const uint8_t dma_rx_request = 0;                // fixed dma mapping
+#endif
+#if defined(STM32F051) || defined(STM32F072)
+    static const uint32_t kernel_clock = 8000000;           // HSI (I2C1SW reset value)
+#elif defined(STM32F767)
+    static const uint32_t kernel_clock = 16000000;          // PCLK1 (HSI)
+#elif defined(STM32G070)
+    static const uint32_t kernel_clock = 64000000;          // PCLK
+#elif defined(STM32G431)
+    static const uint32_t kernel_clock = 170000000;         // PCLK1
+#endif
 };
 
 template<> struct i2c_traits<2>
@@ -25,35 +45,175 @@ template<> struct i2c_traits<2>
     static inline T& I2C() { return device::I2C2; }
     static const gpio::internal::alternate_function_t scl = gpio::internal::I2C2_SCL;
     static const gpio::internal::alternate_function_t sda = gpio::internal::I2C2_SDA;
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_tx_request = dma::I2C2_TX;
+    static const uint8_t dma_rx_request = dma::I2C2_RX;
+#elif defined(STM32F7)
+    static const uint8_t dma_tx_request = 7;                // dma1 stream 7
+    static const uint8_t dma_rx_request = 7;                // dma1 stream 2 or 3
+#else
+    static const uint8_t dma_tx_request = 0;                // fixed dma mapping
+    static const uint8_t dma_rx_request = 0;                // fixed dma mapping
+#endif
+#if defined(STM32F051) || defined(STM32F072)
+    static const uint32_t kernel_clock = 48000000;          // PCLK
+#elif defined(STM32F767)
+    static const uint32_t kernel_clock = 16000000;          // PCLK1 (HSI)
+#elif defined(STM32G070)
+    static const uint32_t kernel_clock = 64000000;          // PCLK
+#elif defined(STM32G431)
+    static const uint32_t kernel_clock = 170000000;         // PCLK1
+#endif
 };
 
-template<int SPEED> struct i2c_timing
+//
+//  Timing register computation following the reference manual (I2C timings
+//  section): for each prescaler the data hold (SDADEL) and setup (SCLDEL)
+//  delays are fitted into their bounds for the bus mode, then SCL low and
+//  high periods are sized so that the period including synchronization
+//  delays is no shorter than the target and each phase meets the minimum
+//  of the standard. The smallest workable prescaler gives the finest period
+//  resolution. All times are in picoseconds, a result of zero means the
+//  speed is unreachable.
+//
+
+struct i2c_bus_spec_t
 {
-    static_assert(always_false_i<SPEED>::value, "don't know timing for this speed");
+    uint32_t    t_low;                              // minimum scl low period
+    uint32_t    t_high;                             // minimum scl high period
+    uint32_t    t_su_dat;                           // minimum data setup time
+    uint32_t    t_vd_dat;                           // maximum data valid time
 };
 
-template<> struct i2c_timing<100000> { static const uint32_t value = 0x10707DBC; };
-template<> struct i2c_timing<400000> { static const uint32_t value = 0x00602173; };
-template<> struct i2c_timing<1000000> { static const uint32_t value = 0x00300B29; };
+static constexpr i2c_bus_spec_t i2c_bus_spec(uint32_t speed)    // in nanoseconds
+{
+    return speed <= 100000 ? i2c_bus_spec_t { 4700, 4000, 250, 3450 }  // standard-mode
+         : speed <= 400000 ? i2c_bus_spec_t { 1300, 600, 100, 900 }    // fast-mode
+         : i2c_bus_spec_t { 500, 260, 50, 450 }                         // fast-mode plus
+         ;
+}
+
+static constexpr int64_t i2c_ceil_div(int64_t x, int64_t y)    // zero for non-positive x
+{
+    return x > 0 ? (x + y - 1) / y : 0;
+}
+
+static constexpr uint32_t i2c_timing_value
+    ( uint32_t clock                                // i2c kernel clock
+    , uint32_t speed                                // target bus speed
+    , uint32_t rise_ns                              // scl/sda rise time
+    , uint32_t fall_ns                              // scl/sda fall time
+    , bool analog_filter                            // analog noise filter enabled
+    , uint8_t dnf                                   // digital noise filter length
+    )
+{
+    if (speed == 0 || speed > 1000000)
+        return 0;
+
+    const i2c_bus_spec_t spec = i2c_bus_spec(speed);
+    const int64_t t_clk = 1000000000000ll / clock;
+    const int64_t t_r = rise_ns * 1000ll, t_f = fall_ns * 1000ll;
+    const int64_t t_af_min = analog_filter ? 50000 : 0, t_af_max = analog_filter ? 260000 : 0;
+    const int64_t t_dnf = dnf * t_clk;
+    const int64_t t_scl = 1000000000000ll / speed;
+    const int64_t t_sync1 = t_f + t_af_min + t_dnf + 2 * t_clk;    // scl falling edge detection
+    const int64_t t_sync2 = t_r + t_af_min + t_dnf + 2 * t_clk;    // scl rising edge detection
+    const int64_t sdadel_min = t_f - t_af_min - t_dnf - 3 * t_clk;
+    const int64_t sdadel_max = spec.t_vd_dat * 1000ll - t_r - t_af_max - t_dnf - 4 * t_clk;
+    const int64_t scldel_min = t_r + spec.t_su_dat * 1000ll;
+    const int64_t t_low = spec.t_low * 1000ll, t_high = spec.t_high * 1000ll;
+
+    if (sdadel_max < 0 || t_sync1 + t_sync2 >= t_scl)
+        return 0;
+
+    for (int64_t presc = 0; presc < 16; ++presc)
+    {
+        const int64_t t_presc = (presc + 1) * t_clk;
+        const int64_t sdadel = i2c_ceil_div(sdadel_min, t_presc);
+        const int64_t scldel = i2c_ceil_div(scldel_min, t_presc);   // SCLDEL + 1
+
+        if (sdadel > 15 || sdadel * t_presc > sdadel_max || scldel > 16)
+            continue;
+
+        const int64_t n = i2c_ceil_div(t_scl - t_sync1 - t_sync2, t_presc);
+        const int64_t l_min = i2c_ceil_div(t_low - t_sync1, t_presc);
+        const int64_t h_min = i2c_ceil_div(t_high - t_sync2, t_presc);
+        const int64_t l_fit = i2c_ceil_div(n * t_low, t_low + t_high);
+        int64_t l = l_fit > l_min ? l_fit : l_min;                   // SCLL + 1
+        int64_t h = n > l ? n - l : 0;                              // SCLH + 1
+
+        if (h < h_min)
+            h = h_min;
+        if (l <= sdadel + scldel)                                   // data must settle while low
+            l = sdadel + scldel + 1;
+        if (l < 1)
+            l = 1;
+        if (h < 1)
+            h = 1;
+        if (l > 256 || h > 256)
+            continue;
+
+        return static_cast<uint32_t>(presc << 28 | (scldel - (scldel > 0 ? 1 : 0)) << 20 | sdadel << 16 | (h - 1) << 8 | (l - 1));
+    }
+
+    return 0;
+}
+
+template<uint32_t CLOCK, uint32_t SPEED, uint16_t RISE_NS, uint16_t FALL_NS, bool ANALOG_FILTER, uint8_t DNF>
+struct i2c_timing
+{
+    static_assert(SPEED > 0 && SPEED <= 1000000, "i2c speed beyond fast-mode plus");
+    static_assert(DNF < 16, "digital noise filter length out of range");
+
+    static constexpr uint32_t value = i2c_timing_value(CLOCK, SPEED, RISE_NS, FALL_NS, ANALOG_FILTER, DNF);
+
+    static_assert(value != 0, "i2c speed unreachable with this kernel clock, rise/fall times and filters");
+};
+
+template<int NO>
+static void enable_fast_mode_plus()                 // 20mA drive on i2c pins
+{
+    using namespace device;
+
+#if defined(STM32F051) || defined(STM32F072)
+    peripheral_traits<syscfg_comp_t>::enable();
+    SYSCFG_COMP.SYSCFG_CFGR1 |= NO == 1 ? syscfg_comp_t::SYSCFG_CFGR1_I2C1_FM_plus : syscfg_comp_t::SYSCFG_CFGR1_I2C2_FM_plus;
+#elif defined(STM32G070)
+    RCC.APBENR2 |= rcc_t::APBENR2_SYSCFGEN;         // enable syscfg clock
+    SYSCFG_VREFBUF.CFGR1 |= NO == 1 ? syscfg_vrefbuf_t::CFGR1_I2C1_FMP : syscfg_vrefbuf_t::CFGR1_I2C2_FMP;
+#elif defined(STM32G431)
+    peripheral_traits<syscfg_t>::enable();
+    SYSCFG.CFGR1 |= NO == 1 ? syscfg_t::CFGR1_I2C1_FMP : syscfg_t::CFGR1_I2C2_FMP;
+#elif defined(STM32F767)
+    peripheral_traits<syscfg_t>::enable();
+    SYSCFG.PMC |= 1 << (NO - 1);                    // I2Cx_FMP, missing from device header
+#endif
+}
 
 template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA>
 struct i2c_t
 {
     typedef typename i2c_traits<NO>::T _;
 
-    template<int SPEED>
+    template<int SPEED, uint16_t RISE_NS = 100, uint16_t FALL_NS = 10, bool ANALOG_FILTER = true, uint8_t DNF = 0>
     static void setup()
     {
         using namespace gpio::internal;
+        typedef i2c_timing<i2c_traits<NO>::kernel_clock, SPEED, RISE_NS, FALL_NS, ANALOG_FILTER, DNF> timing;
 
-        alternate_t<SCL, i2c_traits<NO>::scl>::template setup<gpio::low_speed, open_drain>();
-        alternate_t<SDA, i2c_traits<NO>::sda>::template setup<gpio::low_speed, open_drain>();
+        alternate_t<SCL, i2c_traits<NO>::scl>::template setup<gpio::low_speed, gpio::open_drain>();
+        alternate_t<SDA, i2c_traits<NO>::sda>::template setup<gpio::low_speed, gpio::open_drain>();
 
         device::peripheral_traits<_>::enable();     // enable peripheral clock
 
-        I2C().TIMINGR = i2c_timing<SPEED>::value;   // set timing register
+        if (SPEED > 400000)
+            enable_fast_mode_plus<NO>();            // fast-mode plus drive strength
+
+        I2C().TIMINGR = timing::value;              // set timing register
         I2C().CR2 = _::CR2_RESET_VALUE;             // reset control register 2
         I2C().CR1 = _::CR1_RESET_VALUE              // reset control register 1
+                  | (ANALOG_FILTER ? 0 : _::CR1_ANFOFF) // analog noise filter
+                  | _::template CR1_DNF<DNF>        // digital noise filter
                   | _::CR1_PE                       // enable i2c peripheral
                   ;
     }
@@ -68,10 +228,10 @@ template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA>
 class i2c_master_t
 {
 public:
-    template<int SPEED = 100000>
+    template<int SPEED = 100000, uint16_t RISE_NS = 100, uint16_t FALL_NS = 10, bool ANALOG_FILTER = true, uint8_t DNF = 0>
     static void setup()
     {
-        internal::i2c_t<NO, SCL, SDA>::template setup<SPEED>();
+        internal::i2c_t<NO, SCL, SDA>::template setup<SPEED, RISE_NS, FALL_NS, ANALOG_FILTER, DNF>();
     }
 
     // FIXME: template type to use 10-bit
@@ -167,6 +327,251 @@ private:
     }
 };
 
+enum i2c_status_t
+    { i2c_idle                                      // not submitted
+    , i2c_queued                                    // waiting in queue
+    , i2c_busy                                      // on the bus
+    , i2c_done                                      // completed successfully
+    , i2c_nack                                      // address or data not acknowledged
+    , i2c_error                                     // bus error, arbitration loss or overrun
+    , i2c_timeout                                   // aborted after time-out
+    };
+
+//
+//  A transaction is a write, a read or a write followed by a repeated start
+//  read (when both txlen and rxlen are non-zero). Transactions are owned by
+//  the caller and must stay alive until completed; status is updated from
+//  interrupt context and the optional callback runs there too.
+//
+struct i2c_transaction_t
+{
+    typedef void (*callback_t)(i2c_transaction_t *t);
+
+    uint8_t                 addr;                   // slave address (as for i2c_master_t)
+    const uint8_t           *txbuf;
+    uint16_t                txlen;
+    uint8_t                 *rxbuf;
+    uint16_t                rxlen;
+    uint16_t                timeout;                // milliseconds, 0 means no time-out
+    callback_t              callback;               // invoked on completion, may be null
+    volatile i2c_status_t   status;
+};
+
+//
+//  Asynchronous master: transactions are queued and executed back-to-back
+//  with dma moving the data and interrupts only on transfer events (reload,
+//  transfer complete, stop, nack and errors). Transfers longer than 255 bytes
+//  use NBYTES reload. Call isr from the i2c event (and error) handlers and
+//  poll_timeout periodically (e.g. from a 1ms timer) to enforce time-outs.
+//
+template
+    < int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA
+    , typename DMA, uint8_t TXCH, uint8_t RXCH
+    , uint8_t QSIZE = 8
+    >
+class i2c_async_master_t
+{
+public:
+    template<int SPEED = 100000, uint16_t RISE_NS = 100, uint16_t FALL_NS = 10, bool ANALOG_FILTER = true, uint8_t DNF = 0>
+    static void setup()
+    {
+        m_head = m_tail = 0;
+        m_current = 0;
+
+        internal::i2c_t<NO, SCL, SDA>::template setup<SPEED, RISE_NS, FALL_NS, ANALOG_FILTER, DNF>();
+        DMA::setup();
+
+        I2C().CR1 |= _::CR1_TXDMAEN                 // enable transmit dma requests
+                  |  _::CR1_RXDMAEN                 // enable receive dma requests
+                  |  _::CR1_TCIE                    // transfer complete (and reload) interrupt
+                  |  _::CR1_STOPIE                  // stop condition interrupt
+                  |  _::CR1_NACKIE                  // nack received interrupt
+                  |  _::CR1_ERRIE                   // error interrupts
+                  ;
+    }
+
+    static bool submit(i2c_transaction_t *t)        // false if queue is full
+    {
+        critical_section_t cs;
+        uint8_t next = (m_tail + 1) % (QSIZE + 1);
+
+        if (next == m_head)
+            return false;
+        t->status = i2c_queued;
+        m_queue[m_tail] = t;
+        m_tail = next;
+        if (!m_current)
+            start_next();
+        return true;
+    }
+
+    static inline bool busy()
+    {
+        return m_current != 0;
+    }
+
+    static void isr()
+    {
+        uint32_t sts = I2C().ISR;
+
+        if (!m_current)
+            return;
+
+        if (sts & (_::ISR_BERR | _::ISR_ARLO | _::ISR_OVR))
+        {
+            I2C().ICR = _::ICR_BERRCF | _::ICR_ARLOCF | _::ICR_OVRCF;
+            abort(i2c_error);
+        }
+        else if (sts & _::ISR_NACKF)
+        {
+            I2C().ICR = _::ICR_NACKCF;              // clear nack flag
+            m_result = i2c_nack;
+            if (!(I2C().CR2 & _::CR2_AUTOEND))
+                I2C().CR2 |= _::CR2_STOP;           // stop is not automatic without autoend
+        }
+        else if (sts & _::ISR_STOPF)
+        {
+            I2C().ICR = _::ICR_STOPCF;              // clear stop flag
+            complete(m_result);
+        }
+        else if (sts & _::ISR_TCR)                  // reload: next chunk of current phase
+        {
+            m_remaining -= m_chunk;
+            I2C().CR2 = (I2C().CR2 & ~(_::template CR2_NBYTES<0xff> | _::CR2_RELOAD | _::CR2_START))
+                      | chunk_bits(m_reading || !m_current->rxlen)
+                      ;
+        }
+        else if (sts & _::ISR_TC)                   // write phase done, turn around
+            start_phase(true);
+    }
+
+    static void poll_timeout()                      // call periodically
+    {
+        critical_section_t cs;
+
+        if (m_current && m_current->timeout && sys_tick::count() - m_start > m_current->timeout)
+            abort(i2c_timeout);
+    }
+
+private:
+    static void start_next()
+    {
+        if (m_head == m_tail)
+        {
+            m_current = 0;
+            return;
+        }
+
+        m_current = m_queue[m_head];
+        m_head = (m_head + 1) % (QSIZE + 1);
+        m_current->status = i2c_busy;
+        m_result = i2c_done;
+        m_start = sys_tick::count();
+        start_phase(m_current->txlen == 0);
+    }
+
+    static void start_phase(bool reading)
+    {
+        i2c_transaction_t *t = m_current;
+
+        m_reading = reading;
+        m_remaining = reading ? t->rxlen : t->txlen;
+
+        if (reading)
+        {
+            DMA::template disable<RXCH>();
+            DMA::template periph_to_mem<RXCH, uint8_t, dma::dma_type_size<uint8_t>(), dma::linear>(&I2C().RXDR, t->rxbuf, t->rxlen);
+            DMA::template request<RXCH, internal::i2c_traits<NO>::dma_rx_request>();
+            DMA::template enable<RXCH>();
+        }
+        else
+        {
+            DMA::template disable<TXCH>();
+            DMA::template mem_to_periph<TXCH, uint8_t, dma::dma_type_size<uint8_t>(), dma::linear>(t->txbuf, t->txlen, &I2C().TXDR);
+            DMA::template request<TXCH, internal::i2c_traits<NO>::dma_tx_request>();
+            DMA::template enable<TXCH>();
+        }
+
+        I2C().CR2 = _::CR2_RESET_VALUE              // reset control register 2
+                  | chunk_bits(reading || !t->rxlen)
+                  | (reading ? _::CR2_RD_WRN : 0)   // master read (true) or write (false)
+                  | _::CR2_START                    // generate (repeated) start condition
+                  | t->addr                         // slave address
+                  ;
+    }
+
+    static uint32_t chunk_bits(bool last_phase)
+    {
+        m_chunk = m_remaining > 255 ? 255 : m_remaining;
+
+        return (static_cast<uint32_t>(m_chunk) << 16)                   // number of bytes in chunk
+             | (m_remaining > 255 ? _::CR2_RELOAD                       // more chunks to follow
+               : last_phase ? _::CR2_AUTOEND : 0)                       // stop or turn around at end
+             ;
+    }
+
+    static void abort(i2c_status_t status)
+    {
+        DMA::template disable<TXCH>();
+        DMA::template disable<RXCH>();
+        I2C().CR1 &= ~_::CR1_PE;                    // software reset releases the bus
+        while (I2C().CR1 & _::CR1_PE);
+        I2C().CR1 |= _::CR1_PE;
+        complete(status);
+    }
+
+    static void complete(i2c_status_t status)
+    {
+        i2c_transaction_t *t = m_current;
+
+        t->status = status;
+        start_next();                               // keep the bus busy
+        if (t->callback)
+            t->callback(t);
+    }
+
+    typedef typename internal::i2c_traits<NO>::T _;
+    static inline typename internal::i2c_traits<NO>::T& I2C()
+    {
+        return internal::i2c_traits<NO>::I2C();
+    }
+
+    static i2c_transaction_t    *m_queue[QSIZE + 1];
+    static i2c_transaction_t    *volatile m_current;
+    static volatile uint8_t     m_head, m_tail;
+    static uint16_t             m_remaining, m_chunk;
+    static bool                 m_reading;
+    static i2c_status_t         m_result;
+    static uint32_t             m_start;
+};
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+i2c_transaction_t *i2c_async_master_t<NO, SCL, SDA, DMA, TXCH, RXCH, QSIZE>::m_queue[QSIZE + 1];
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+i2c_transaction_t *volatile i2c_async_master_t<NO, SCL, SDA, DMA, TXCH, RXCH, QSIZE>::m_current = 0;
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+volatile uint8_t i2c_async_master_t<NO, SCL, SDA, DMA, TXCH, RXCH, QSIZE>::m_head = 0;
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+volatile uint8_t i2c_async_master_t<NO, SCL, SDA, DMA, TXCH, RXCH, QSIZE>::m_tail = 0;
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+uint16_t i2c_async_master_t<NO, SCL, SDA, DMA, TXCH, RXCH, QSIZE>::m_remaining = 0;
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+uint16_t i2c_async_master_t<NO, SCL, SDA, DMA, TXCH, RXCH, QSIZE>::m_chunk = 0;
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+bool i2c_async_master_t<NO, SCL, SDA, DMA, TXCH, RXCH, QSIZE>::m_reading = false;
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+i2c_status_t i2c_async_master_t<NO, SCL, SDA, DMA, TXCH, RXCH, QSIZE>::m_result = i2c_idle;
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+uint32_t i2c_async_master_t<NO, SCL, SDA, DMA, TXCH, RXCH, QSIZE>::m_start = 0;
+
 template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA>
 class i2c_slave_t
 {
@@ -346,6 +751,176 @@ uint8_t *i2c_slave_t<NO, SCL, SDA>::m_txptr = 0;
 template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA>
 uint8_t i2c_slave_t<NO, SCL, SDA>::m_txlen = 0;
 
+//
+//  Register map slave: the slave exposes SIZE bytes of memory to the master
+//  through an address pointer with auto-increment. A master write sets the
+//  pointer from its first byte and stores any following bytes from there on;
+//  a master read (typically after a repeated start) returns bytes starting at
+//  the pointer. The pointer is retained across transactions, so repeated reads
+//  return the same registers. Data moves by dma in both directions and only
+//  address match, stop and error events interrupt. Reads past the end of the
+//  map repeat from the pointer, writes past the end are discarded as a whole.
+//  The callback, if any, runs from isr after a write has been applied.
+//
+template
+    < int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA
+    , typename DMA, uint8_t TXCH, uint8_t RXCH
+    , uint16_t SIZE
+    >
+class i2c_register_slave_t
+{
+public:
+    static_assert(SIZE > 0 && SIZE <= 256, "register map must be addressable by an 8-bit pointer");
+
+    typedef void (*callback_t)(uint8_t reg, uint8_t len);
+
+    // FIXME: template type to use 10-bit
+    template<uint32_t SPEED = 100000>
+    static void setup(uint8_t addr, callback_t cb = 0)
+    {
+        m_cb = cb;
+        m_ptr = 0;
+        m_state = idle;
+
+        internal::i2c_t<NO, SCL, SDA>::template setup<SPEED>();
+        DMA::setup();
+
+        I2C().OAR1 = _::OAR1_RESET_VALUE            // reset own address register
+                   | _::OAR1_OA1EN                  // enable own address (ACK)
+                   | addr
+                   ;
+        I2C().CR1 |= _::CR1_TXDMAEN                 // enable transmit dma requests
+                  |  _::CR1_RXDMAEN                 // enable receive dma requests
+                  |  _::CR1_ERRIE                   // enable error interrupt
+                  |  _::CR1_ADDRIE                  // enable address match interrupt
+                  |  _::CR1_STOPIE                  // enable stop condition interrupt
+                  ;
+    }
+
+    static inline uint8_t *registers() { return m_map; }
+
+    static void write(uint8_t reg, const uint8_t *buf, uint16_t len)    // update from application
+    {
+        critical_section_t cs;
+
+        for (uint16_t i = 0; i < len && reg + i < SIZE; ++i)
+            m_map[reg + i] = buf[i];
+    }
+
+    static void read(uint8_t reg, uint8_t *buf, uint16_t len)           // coherent snapshot
+    {
+        critical_section_t cs;
+
+        for (uint16_t i = 0; i < len && reg + i < SIZE; ++i)
+            buf[i] = m_map[reg + i];
+    }
+
+    static void isr()
+    {
+        uint32_t sts = I2C().ISR;
+
+        if (sts & (_::ISR_BERR | _::ISR_ARLO | _::ISR_OVR))
+        {
+            I2C().ICR = _::ICR_BERRCF | _::ICR_ARLOCF | _::ICR_OVRCF;
+            DMA::template disable<TXCH>();
+            DMA::template disable<RXCH>();
+            m_state = idle;
+        }
+        else if (sts & _::ISR_ADDR)                 // address matched (or repeated start)
+        {
+            if (m_state == receiving)
+                apply_write();                      // pointer write before repeated start
+            if (sts & _::ISR_DIR)
+            {
+                DMA::template disable<TXCH>();
+                I2C().ISR |= _::ISR_TXE;            // flush stale transmit data
+                DMA::template mem_to_periph<TXCH, uint8_t, dma::dma_type_size<uint8_t>()>(m_map + m_ptr, SIZE - m_ptr, &I2C().TXDR);
+                DMA::template request<TXCH, internal::i2c_traits<NO>::dma_tx_request>();
+                DMA::template enable<TXCH>();
+                m_state = transmitting;
+            }
+            else
+            {
+                DMA::template disable<RXCH>();
+                DMA::template periph_to_mem<RXCH, uint8_t, dma::dma_type_size<uint8_t>()>(&I2C().RXDR, m_stage, stage_size);
+                DMA::template request<RXCH, internal::i2c_traits<NO>::dma_rx_request>();
+                DMA::template enable<RXCH>();
+                m_state = receiving;
+            }
+            I2C().ICR = _::ICR_ADDRCF;              // release clock stretching
+        }
+        else if (sts & _::ISR_STOPF)                // end of transaction
+        {
+            I2C().ICR = _::ICR_STOPCF | _::ICR_NACKCF;
+            if (m_state == receiving)
+                apply_write();
+            else if (m_state == transmitting)
+            {
+                DMA::template disable<TXCH>();
+                I2C().ISR |= _::ISR_TXE;            // flush prefetched byte
+            }
+            m_state = idle;
+        }
+    }
+
+private:
+    enum state_t { idle, transmitting, receiving };
+
+    static constexpr uint16_t stage_size = SIZE + 2;    // pointer, data and one overflow byte
+
+    static void apply_write()
+    {
+        DMA::template disable<RXCH>();
+
+        bool overflow = DMA::template interrupt_status<RXCH>() & dma::dma_transfer_complete;
+        uint16_t n = stage_size - DMA::template remaining<RXCH>();
+
+        DMA::template clear_interrupt_flags<RXCH>();
+        if (overflow || n == 0)                     // circular buffer wrapped or no data
+            return;
+
+        uint8_t reg = m_stage[0] < SIZE ? m_stage[0] : 0;
+        uint16_t len = n - 1;
+
+        m_ptr = reg;
+        if (len > SIZE - reg)
+            len = SIZE - reg;
+        for (uint16_t i = 0; i < len; ++i)
+            m_map[reg + i] = m_stage[i + 1];
+        if (len && m_cb)
+            m_cb(reg, len);
+    }
+
+    typedef typename internal::i2c_traits<NO>::T _;
+    static inline typename internal::i2c_traits<NO>::T& I2C()
+    {
+        return internal::i2c_traits<NO>::I2C();
+    }
+
+    static uint8_t              m_map[SIZE];
+    static uint8_t              m_stage[stage_size];
+    static volatile uint8_t     m_ptr;
+    static volatile state_t     m_state;
+    static callback_t           m_cb;
+};
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint16_t SIZE>
+uint8_t i2c_register_slave_t<NO, SCL, SDA, DMA, TXCH, RXCH, SIZE>::m_map[SIZE];
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint16_t SIZE>
+uint8_t i2c_register_slave_t<NO, SCL, SDA, DMA, TXCH, RXCH, SIZE>::m_stage[stage_size];
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint16_t SIZE>
+volatile uint8_t i2c_register_slave_t<NO, SCL, SDA, DMA, TXCH, RXCH, SIZE>::m_ptr = 0;
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint16_t SIZE>
+volatile typename i2c_register_slave_t<NO, SCL, SDA, DMA, TXCH, RXCH, SIZE>::state_t
+i2c_register_slave_t<NO, SCL, SDA, DMA, TXCH, RXCH, SIZE>::m_state = i2c_register_slave_t<NO, SCL, SDA, DMA, TXCH, RXCH, SIZE>::idle;
+
+template<int NO, gpio::gpio_pin_t SCL, gpio::gpio_pin_t SDA, typename DMA, uint8_t TXCH, uint8_t RXCH, uint16_t SIZE>
+typename i2c_register_slave_t<NO, SCL, SDA, DMA, TXCH, RXCH, SIZE>::callback_t
+i2c_register_slave_t<NO, SCL, SDA, DMA, TXCH, RXCH, SIZE>::m_cb = 0;
+
 } // namespace i2c
 } // namespace hal
 
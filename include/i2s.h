@@ -28,9 +28,16 @@ enum i2s_format_t
     , format_32_32 = 0x2
     };
 
+enum i2s_mode_t
+    { slave_transmit    = 0x0
+    , slave_receive     = 0x1
+    , master_transmit   = 0x2
+    , master_receive    = 0x3
+    };
+
 template<int NO> struct i2s_traits {};
 
-#if !defined(STM32G431)
+#if defined(STM32G0)
 template<> struct i2s_traits<1>
 {
     typedef spi1_t T;
@@ -39,10 +46,12 @@ template<> struct i2s_traits<1>
     static const gpio::internal::alternate_function_t mck = gpio::internal::I2S1_MCK;
     static const gpio::internal::alternate_function_t sd = gpio::internal::I2S1_SD;
     static const gpio::internal::alternate_function_t ws = gpio::internal::I2S1_WS;
-    static const dma::resource_t tx_request = dma::SPI1_TX;
+    static const uint8_t tx_request = dma::SPI1_TX;
+    static const uint8_t rx_request = dma::SPI1_RX;
 };
 #endif
 
+#if defined(STM32G4)
 template<> struct i2s_traits<2>
 {
     typedef spi2_t T;
@@ -51,7 +60,8 @@ template<> struct i2s_traits<2>
     static const gpio::internal::alternate_function_t mck = gpio::internal::I2S2_MCK;
     static const gpio::internal::alternate_function_t sd = gpio::internal::I2S2_SD;
     static const gpio::internal::alternate_function_t ws = gpio::internal::I2S2_WS;
-    static const dma::resource_t tx_request = dma::SPI2_TX;
+    static const uint8_t tx_request = dma::SPI2_TX;
+    static const uint8_t rx_request = dma::SPI2_RX;
 };
 
 template<> struct i2s_traits<3>
@@ -62,8 +72,120 @@ template<> struct i2s_traits<3>
     static const gpio::internal::alternate_function_t mck = gpio::internal::I2S3_MCK;
     static const gpio::internal::alternate_function_t sd = gpio::internal::I2S3_SD;
     static const gpio::internal::alternate_function_t ws = gpio::internal::I2S3_WS;
-    static const dma::resource_t tx_request = dma::SPI3_TX;
+    static const uint8_t tx_request = dma::SPI3_TX;
+    static const uint8_t rx_request = dma::SPI3_RX;
 };
+#endif
+
+#if defined(STM32F4)
+template<> struct i2s_traits<2>
+{
+    typedef spi2_t T;
+    static inline T& I2S() { return SPI2; }
+    static const gpio::internal::alternate_function_t ck = gpio::internal::I2S2_CK;
+    static const gpio::internal::alternate_function_t mck = gpio::internal::I2S2_MCK;
+    static const gpio::internal::alternate_function_t sd = gpio::internal::I2S2_SD;
+    static const gpio::internal::alternate_function_t ws = gpio::internal::I2S2_WS;
+    static const uint8_t tx_request = 0;                    // dma1 stream 4
+    static const uint8_t rx_request = 0;                    // dma1 stream 3
+    typedef i2s2ext_t EXT;
+    static inline EXT& I2SEXT() { return I2S2EXT; }
+    static const gpio::internal::alternate_function_t ext_sd = gpio::internal::I2S2ext_SD;
+    static const uint8_t ext_tx_request = 2;                // dma1 stream 4
+    static const uint8_t ext_rx_request = 3;                // dma1 stream 3
+};
+
+template<> struct i2s_traits<3>
+{
+    typedef spi3_t T;
+    static inline T& I2S() { return SPI3; }
+    static const gpio::internal::alternate_function_t ck = gpio::internal::I2S3_CK;
+    static const gpio::internal::alternate_function_t mck = gpio::internal::I2S3_MCK;
+    static const gpio::internal::alternate_function_t sd = gpio::internal::I2S3_SD;
+    static const gpio::internal::alternate_function_t ws = gpio::internal::I2S3_WS;
+    static const uint8_t tx_request = 0;                    // dma1 stream 5 or 7
+    static const uint8_t rx_request = 0;                    // dma1 stream 0 or 2
+    typedef i2s3ext_t EXT;
+    static inline EXT& I2SEXT() { return I2S3EXT; }
+    static const gpio::internal::alternate_function_t ext_sd = gpio::internal::I2S3ext_SD;
+    static const uint8_t ext_tx_request = 2;                // dma1 stream 5
+    static const uint8_t ext_rx_request = 3;                // dma1 stream 0
+};
+#endif
+
+template<typename _, i2s_standard_t standard, i2s_clock_polarity_t polarity, i2s_format_t format, i2s_mode_t mode>
+static constexpr uint32_t i2s_configuration()
+{
+    return _::I2SCFGR_RESET_VALUE                               // reset i2s configuration register
+         | _::I2SCFGR_I2SMOD                                    // enable i2s mode
+         | _::template I2SCFGR_I2SCFG<mode>                     // transmit/receive, master/slave
+         | _::template I2SCFGR_I2SSTD<standard>                 // standard selection
+         | (polarity == high_level ? _::I2SCFGR_CKPOL : 0)      // clock polarity
+         | _::template I2SCFGR_DATLEN<format & 0x3>             // data length
+         | ((format & 0x4) ? _::I2SCFGR_CHLEN : 0)              // 32-bit channel width
+         ;
+}
+
+//
+//  DMA buffer formats. The data register is 16 bits wide and 24/32-bit
+//  samples go out most significant half-word first, so a dma-ready buffer of
+//  uint32_t holds each sample with its half-words swapped (24-bit samples are
+//  left-aligned first). The dma then moves half-words straight from memory
+//  to the data register. Use the block converters below to pack and unpack
+//  signed right-aligned samples; they work in place.
+//
+
+template<i2s_format_t> struct i2s_sample_traits { typedef uint16_t T; };
+template<> struct i2s_sample_traits<format_24_32> { typedef uint32_t T; };
+template<> struct i2s_sample_traits<format_32_32> { typedef uint32_t T; };
+
+__attribute__((always_inline))
+static inline uint32_t swap_halfwords(uint32_t x)
+{
+    return (x << 16) | (x >> 16);                               // single ror instruction
+}
+
+template<i2s_format_t FORMAT>
+static inline void pack(const int32_t *src, uint32_t *dst, uint16_t n)
+{
+    static_assert(FORMAT == format_24_32 || FORMAT == format_32_32, "packing only applies to 24 and 32-bit data");
+
+    constexpr uint8_t shift = FORMAT == format_24_32 ? 8 : 0;
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        uint32_t a = src[0], b = src[1], c = src[2], d = src[3];
+
+        dst[0] = swap_halfwords(a << shift);
+        dst[1] = swap_halfwords(b << shift);
+        dst[2] = swap_halfwords(c << shift);
+        dst[3] = swap_halfwords(d << shift);
+    }
+
+    while (n--)
+        *dst++ = swap_halfwords(static_cast<uint32_t>(*src++) << shift);
+}
+
+template<i2s_format_t FORMAT>
+static inline void unpack(const uint32_t *src, int32_t *dst, uint16_t n)
+{
+    static_assert(FORMAT == format_24_32 || FORMAT == format_32_32, "unpacking only applies to 24 and 32-bit data");
+
+    constexpr uint8_t shift = FORMAT == format_24_32 ? 8 : 0;
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        uint32_t a = src[0], b = src[1], c = src[2], d = src[3];
+
+        dst[0] = static_cast<int32_t>(swap_halfwords(a)) >> shift;
+        dst[1] = static_cast<int32_t>(swap_halfwords(b)) >> shift;
+        dst[2] = static_cast<int32_t>(swap_halfwords(c)) >> shift;
+        dst[3] = static_cast<int32_t>(swap_halfwords(d)) >> shift;
+    }
+
+    while (n--)
+        *dst++ = static_cast<int32_t>(swap_halfwords(*src++)) >> shift;
+}
 
 template<int NO, gpio_pin_t CK, gpio_pin_t SD, gpio_pin_t WS> struct i2s_t
 {
@@ -77,8 +199,23 @@ public:
         , i2s_format_t          format
         , uint8_t               divider
         , output_speed_t        speed = high_speed
+        , i2s_mode_t            mode = master_transmit
         >
     static inline void setup()
+    {
+        configure<standard, polarity, format, divider, speed, mode>();
+        enable();                                                       // enable i2s peripheral
+    }
+
+    template
+        < i2s_standard_t        standard
+        , i2s_clock_polarity_t  polarity
+        , i2s_format_t          format
+        , uint8_t               divider
+        , output_speed_t        speed = high_speed
+        , i2s_mode_t            mode = master_transmit
+        >
+    static inline void configure()
     {
         using namespace gpio::internal;
 
@@ -90,14 +227,7 @@ public:
 
         I2S().CR1 = _::CR1_RESET_VALUE;                                 // reset control register 1
         I2S().CR2 = _::CR2_RESET_VALUE;                                 // reset control register 2
-        I2S().I2SCFGR = _::I2SCFGR_RESET_VALUE                          // reset i2s configuration register
-                      | _::I2SCFGR_I2SMOD                               // enable i2s mode
-                      | _::template I2SCFGR_I2SCFG<0x2>                 // master transmit
-                      | _::template I2SCFGR_I2SSTD<standard>            // standard selection
-                      | (polarity == high_level ? _::I2SCFGR_CKPOL : 0) // enable i2s mode
-                      | _::template I2SCFGR_DATLEN<format & 0x3>        // data length
-                      | ((format & 0x4) ? _::I2SCFGR_CHLEN : 0)         // 32-bit channel width
-                      ;
+        I2S().I2SCFGR = i2s_configuration<_, standard, polarity, format, mode>();
 
         static_assert(divider > 3, "I2S clock division must be strictly larger than 3");
 
@@ -105,22 +235,52 @@ public:
                     | ((divider & 0x1) ? _::I2SPR_ODD : 0)              // odd prescaler
                     ;                                                   // FIXME: master clock output enable option
 
+        // note dma and interrupt enable flags are in CR2
+    }
+
+    static inline void enable()
+    {
         I2S().I2SCFGR |= _::I2SCFGR_I2SE;                               // enable i2s peripheral
+    }
 
-        // note dma and interrupt enable flags are in CR2
+    static inline void disable()
+    {
+        I2S().I2SCFGR &= ~_::I2SCFGR_I2SE;                              // disable i2s peripheral
     }
 
     template<typename DMA, uint8_t DMACH, typename T>
     static inline void enable_dma(const T *source, uint16_t nelem)
     {
+        static_assert(sizeof(T) == 2 || sizeof(T) == 4, "I2S dma buffers hold half-words or half-word swapped words");
+
         I2S().CR2 |= _::CR2_TXDMAEN                                     // enable dma transmission
                   ;
         DMA::template disable<DMACH>();                                 // disable dma channel
-        DMA::template mem_to_periph<DMACH>(source, nelem, &I2S().DR);   // configure dma from memory
+        DMA::template mem_to_periph<DMACH, uint16_t, dma::dma_type_size<uint16_t>()>
+            (reinterpret_cast<const uint16_t*>(source), nelem * (sizeof(T) >> 1), &I2S().DR);
+        DMA::template request<DMACH, i2s_traits<NO>::tx_request>();     // route i2s request
         DMA::template enable<DMACH>();                                  // enable dma channel
-#if defined(STM32G431)
-        dma::dmamux_traits<DMA::INST, DMACH>::CCR() = device::dmamux_t::C0CR_DMAREQ_ID<i2s_traits<NO>::tx_request>;
-#endif
+    }
+
+    template<typename DMA, uint8_t DMACH, typename T>
+    static inline void enable_rx_dma(T *dest, uint16_t nelem)
+    {
+        static_assert(sizeof(T) == 2 || sizeof(T) == 4, "I2S dma buffers hold half-words or half-word swapped words");
+
+        I2S().CR2 |= _::CR2_RXDMAEN                                     // enable dma reception
+                  ;
+        DMA::template disable<DMACH>();                                 // disable dma channel
+        DMA::template periph_to_mem<DMACH, uint16_t, dma::dma_type_size<uint16_t>()>
+            (&I2S().DR, reinterpret_cast<uint16_t*>(dest), nelem * (sizeof(T) >> 1));
+        DMA::template request<DMACH, i2s_traits<NO>::rx_request>();     // route i2s request
+        DMA::template enable<DMACH>();                                  // enable dma channel
+    }
+
+    __attribute__((always_inline))
+    static inline uint16_t read16()
+    {
+        while (!(I2S().SR & _::SR_RXNE));       // wait until rx buffer is not empty
+        return I2S().DR;
     }
 
     __attribute__((always_inline))
@@ -178,6 +338,167 @@ private:
     static inline typename i2s_traits<NO>::T& I2S() { return i2s_traits<NO>::I2S(); }
 };
 
+#if defined(HAVE_PERIPHERAL_I2S2EXT) || defined(HAVE_PERIPHERAL_I2S3EXT)
+//
+//  I2S extension block for full-duplex operation. It always runs as a slave
+//  of its main I2S instance and shares clock and word select with it, so only
+//  the data pin is configured. The divider parameter is ignored, it exists to
+//  keep the configure interface uniform with i2s_t.
+//
+template<int NO, gpio_pin_t SD> struct i2s_ext_t
+{
+private:
+    typedef typename i2s_traits<NO>::EXT _;
+
+public:
+    template
+        < i2s_standard_t        standard
+        , i2s_clock_polarity_t  polarity
+        , i2s_format_t          format
+        , uint8_t               divider
+        , output_speed_t        speed = high_speed
+        , i2s_mode_t            mode = slave_receive
+        >
+    static inline void configure()
+    {
+        using namespace gpio::internal;
+
+        static_assert(mode == slave_receive || mode == slave_transmit, "I2S extension block only runs in slave mode");
+
+        alternate_t<SD, i2s_traits<NO>::ext_sd>::template setup<speed>();
+
+        I2S().CR1 = _::CR1_RESET_VALUE;                                 // reset control register 1
+        I2S().CR2 = _::CR2_RESET_VALUE;                                 // reset control register 2
+        I2S().I2SCFGR = i2s_configuration<_, standard, polarity, format, mode>();
+        I2S().I2SPR = _::I2SPR_RESET_VALUE;                             // clocked by the main instance
+    }
+
+    static inline void enable()
+    {
+        I2S().I2SCFGR |= _::I2SCFGR_I2SE;                               // enable i2s extension
+    }
+
+    static inline void disable()
+    {
+        I2S().I2SCFGR &= ~_::I2SCFGR_I2SE;                              // disable i2s extension
+    }
+
+    template<typename DMA, uint8_t DMACH, typename T>
+    static inline void enable_dma(const T *source, uint16_t nelem)
+    {
+        static_assert(sizeof(T) == 2 || sizeof(T) == 4, "I2S dma buffers hold half-words or half-word swapped words");
+
+        I2S().CR2 |= _::CR2_TXDMAEN;                                    // enable dma transmission
+        DMA::template disable<DMACH>();                                 // disable dma stream
+        DMA::template mem_to_periph<DMACH, uint16_t, dma::dma_type_size<uint16_t>()>
+            (reinterpret_cast<const uint16_t*>(source), nelem * (sizeof(T) >> 1), &I2S().DR);
+        DMA::template request<DMACH, i2s_traits<NO>::ext_tx_request>(); // route i2s request
+        DMA::template enable<DMACH>();                                  // enable dma stream
+    }
+
+    template<typename DMA, uint8_t DMACH, typename T>
+    static inline void enable_rx_dma(T *dest, uint16_t nelem)
+    {
+        static_assert(sizeof(T) == 2 || sizeof(T) == 4, "I2S dma buffers hold half-words or half-word swapped words");
+
+        I2S().CR2 |= _::CR2_RXDMAEN;                                    // enable dma reception
+        DMA::template disable<DMACH>();                                 // disable dma stream
+        DMA::template periph_to_mem<DMACH, uint16_t, dma::dma_type_size<uint16_t>()>
+            (&I2S().DR, reinterpret_cast<uint16_t*>(dest), nelem * (sizeof(T) >> 1));
+        DMA::template request<DMACH, i2s_traits<NO>::ext_rx_request>(); // route i2s request
+        DMA::template enable<DMACH>();                                  // enable dma stream
+    }
+
+private:
+    static inline typename i2s_traits<NO>::EXT& I2S() { return i2s_traits<NO>::I2SEXT(); }
+};
+#endif
+
+//
+//  Full-duplex streaming: MASTER transmits and generates the clocks, SLAVE
+//  receives on the same clocks. On F4 the slave is the I2S extension block of
+//  the master (i2s_ext_t). On G4 it is a second I2S instance whose CK and WS
+//  pins are wired to those of the master. Both dma rings have the same size
+//  and are started before the clock, so input and output frames stay locked.
+//  The processor is called from the receive dma interrupt (call isr from its
+//  handler) once per block with the block just received and the output block
+//  to fill, which goes out two blocks later. Blocks hold interleaved samples
+//  in dma buffer format (see above), two per frame.
+//
+template
+    < typename MASTER, typename SLAVE
+    , typename TX_DMA, uint8_t TX_DMACH
+    , typename RX_DMA, uint8_t RX_DMACH
+    , i2s_format_t FORMAT
+    , uint16_t BLOCK_SIZE                       // frames per block
+    >
+class i2s_duplex_t
+{
+public:
+    typedef typename i2s_sample_traits<FORMAT>::T sample_t;
+    typedef void (*process_t)(const sample_t *input, sample_t *output);
+
+    static constexpr uint16_t block_size = BLOCK_SIZE;
+    static constexpr uint16_t block_samples = BLOCK_SIZE * 2;   // both channels interleaved
+    static constexpr uint16_t buffer_samples = 2 * block_samples;
+
+    template
+        < i2s_standard_t        standard
+        , i2s_clock_polarity_t  polarity
+        , uint8_t               divider
+        , output_speed_t        speed = high_speed
+        >
+    static void setup(process_t process)
+    {
+        m_process = process;
+
+        SLAVE::template configure<standard, polarity, FORMAT, divider, speed, slave_receive>();
+        MASTER::template configure<standard, polarity, FORMAT, divider, speed, master_transmit>();
+
+        RX_DMA::setup();
+        if (TX_DMA::INST != RX_DMA::INST)
+            TX_DMA::setup();
+
+        SLAVE::template enable_rx_dma<RX_DMA, RX_DMACH>(m_input, buffer_samples);
+        RX_DMA::template enable_interrupt<RX_DMACH, true>();
+        MASTER::template enable_dma<TX_DMA, TX_DMACH>(m_output, buffer_samples);
+
+        SLAVE::enable();                                    // slave must be ready before the clock starts
+        MASTER::enable();                                   // start clock and word select
+    }
+
+    static inline void isr()
+    {
+        uint32_t sts = RX_DMA::template interrupt_status<RX_DMACH>();
+
+        RX_DMA::template clear_interrupt_flags<RX_DMACH>();
+
+        if (sts & (dma::dma_half_transfer | dma::dma_transfer_complete))
+        {
+            uint16_t offset = sts & dma::dma_transfer_complete ? block_samples : 0;
+
+            m_process(m_input + offset, m_output + offset);
+        }
+    }
+
+private:
+    static sample_t m_input[buffer_samples];
+    static sample_t m_output[buffer_samples];
+    static process_t m_process;
+};
+
+template<typename MASTER, typename SLAVE, typename TX_DMA, uint8_t TX_DMACH, typename RX_DMA, uint8_t RX_DMACH, i2s_format_t FORMAT, uint16_t BLOCK_SIZE>
+typename i2s_duplex_t<MASTER, SLAVE, TX_DMA, TX_DMACH, RX_DMA, RX_DMACH, FORMAT, BLOCK_SIZE>::sample_t
+i2s_duplex_t<MASTER, SLAVE, TX_DMA, TX_DMACH, RX_DMA, RX_DMACH, FORMAT, BLOCK_SIZE>::m_input[];
+
+template<typename MASTER, typename SLAVE, typename TX_DMA, uint8_t TX_DMACH, typename RX_DMA, uint8_t RX_DMACH, i2s_format_t FORMAT, uint16_t BLOCK_SIZE>
+typename i2s_duplex_t<MASTER, SLAVE, TX_DMA, TX_DMACH, RX_DMA, RX_DMACH, FORMAT, BLOCK_SIZE>::sample_t
+i2s_duplex_t<MASTER, SLAVE, TX_DMA, TX_DMACH, RX_DMA, RX_DMACH, FORMAT, BLOCK_SIZE>::m_output[];
+
+template<typename MASTER, typename SLAVE, typename TX_DMA, uint8_t TX_DMACH, typename RX_DMA, uint8_t RX_DMACH, i2s_format_t FORMAT, uint16_t BLOCK_SIZE>
+typename i2s_duplex_t<MASTER, SLAVE, TX_DMA, TX_DMACH, RX_DMA, RX_DMACH, FORMAT, BLOCK_SIZE>::process_t
+i2s_duplex_t<MASTER, SLAVE, TX_DMA, TX_DMACH, RX_DMA, RX_DMACH, FORMAT, BLOCK_SIZE>::m_process = 0;
+
 }
 
 }
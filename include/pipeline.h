@@ -0,0 +1,107 @@
+#pragma once
+
+#include "hal.h"
+#include "timer.h"
+#include "adc.h"
+#include "dac.h"
+#include "dma.h"
+
+namespace hal
+{
+
+namespace pipeline
+{
+
+//
+//  Block processing pipeline: a timer update event (TRGO) triggers both an adc
+//  conversion and a dac output at the sample rate. The adc fills a circular
+//  double buffer by dma, the dac drains another circular double buffer by dma,
+//  and the processor is called from the adc dma interrupt once per half buffer.
+//  Both rings run on the same trigger and are started before the timer, so the
+//  output lags the input by exactly two blocks (plus one sample in the dac hold
+//  register) regardless of processing time, as long as processing of a block
+//  completes within one block period.
+//
+//  The adc must be set up (prescaler, sample time, sequence) and its pins
+//  configured before calling setup. The isr must be called from the handler of
+//  the adc dma channel, e.g.:
+//
+//      template<> void handler<interrupt::DMA1_CH2>() { pipe::isr(); }
+//
+
+template
+    < typename TIMER                            // trigger timer
+    , typename ADC                              // adc_t instance
+    , typename DAC                              // dac_t instance
+    , uint8_t DACCH                             // dac channel
+    , typename ADC_DMA, uint8_t ADC_DMACH       // adc dma instance and channel
+    , typename DAC_DMA, uint8_t DAC_DMACH       // dac dma instance and channel
+    , uint32_t SAMPLE_FREQ                      // sample rate in Hz
+    , uint16_t BLOCK_SIZE                       // samples per block
+    >
+class pipeline_t
+{
+public:
+    typedef void (*process_t)(const uint16_t *input, uint16_t *output);
+
+    static constexpr uint32_t sample_freq = SAMPLE_FREQ;
+    static constexpr uint16_t block_size = BLOCK_SIZE;
+    static constexpr uint16_t buffer_size = 2 * BLOCK_SIZE;
+    static constexpr uint32_t latency = 2 * BLOCK_SIZE;     // in samples, excluding dac hold register
+
+    template<uint8_t ADC_TRIGGER, uint8_t DAC_TRIGGER>
+    static void setup(process_t process)
+    {
+        m_process = process;
+
+        ADC_DMA::setup();
+        if (DAC_DMA::INST != ADC_DMA::INST)
+            DAC_DMA::setup();
+
+        DAC::setup();
+        DAC::template enable_trigger<DACCH, DAC_TRIGGER>();
+        DAC::template enable_dma<DACCH, DAC_DMA, DAC_DMACH, uint16_t>(m_output, buffer_size);
+
+        ADC::template dma<ADC_DMA, ADC_DMACH, uint16_t>(m_input, buffer_size);
+        ADC::template trigger<ADC_TRIGGER>();
+        ADC::enable();
+        ADC::start_conversion();                            // arm for hardware trigger
+
+        TIMER::template setup_frequency<SAMPLE_FREQ>();    // start sample clock
+        TIMER::template master_mode<TIMER::mm_update>();    // update event as trigger output
+    }
+
+    static inline void isr()
+    {
+        uint32_t sts = ADC_DMA::template interrupt_status<ADC_DMACH>();
+
+        ADC_DMA::template clear_interrupt_flags<ADC_DMACH>();
+
+        if (sts & (dma::dma_half_transfer | dma::dma_transfer_complete))
+        {
+            uint16_t offset = sts & dma::dma_transfer_complete ? BLOCK_SIZE : 0;
+
+            m_process(m_input + offset, m_output + offset);
+        }
+    }
+
+private:
+    static uint16_t m_input[buffer_size];
+    static uint16_t m_output[buffer_size];
+    static process_t m_process;
+};
+
+template<typename TIMER, typename ADC, typename DAC, uint8_t DACCH, typename ADC_DMA, uint8_t ADC_DMACH, typename DAC_DMA, uint8_t DAC_DMACH, uint32_t SAMPLE_FREQ, uint16_t BLOCK_SIZE>
+uint16_t pipeline_t<TIMER, ADC, DAC, DACCH, ADC_DMA, ADC_DMACH, DAC_DMA, DAC_DMACH, SAMPLE_FREQ, BLOCK_SIZE>::m_input[];
+
+template<typename TIMER, typename ADC, typename DAC, uint8_t DACCH, typename ADC_DMA, uint8_t ADC_DMACH, typename DAC_DMA, uint8_t DAC_DMACH, uint32_t SAMPLE_FREQ, uint16_t BLOCK_SIZE>
+uint16_t pipeline_t<TIMER, ADC, DAC, DACCH, ADC_DMA, ADC_DMACH, DAC_DMA, DAC_DMACH, SAMPLE_FREQ, BLOCK_SIZE>::m_output[];
+
+template<typename TIMER, typename ADC, typename DAC, uint8_t DACCH, typename ADC_DMA, uint8_t ADC_DMACH, typename DAC_DMA, uint8_t DAC_DMACH, uint32_t SAMPLE_FREQ, uint16_t BLOCK_SIZE>
+typename pipeline_t<TIMER, ADC, DAC, DACCH, ADC_DMA, ADC_DMACH, DAC_DMA, DAC_DMACH, SAMPLE_FREQ, BLOCK_SIZE>::process_t
+pipeline_t<TIMER, ADC, DAC, DACCH, ADC_DMA, ADC_DMACH, DAC_DMA, DAC_DMACH, SAMPLE_FREQ, BLOCK_SIZE>::m_process = 0;
+
+} // namespace pipeline
+
+} // namespace hal
+
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <gpio.h>
+#include "dma.h"
+
+namespace hal
+{
+
+namespace sai
+{
+
+using namespace gpio;
+
+enum sai_block_t { block_a, block_b };
+
+enum sai_mode_t
+    { master_transmit   = 0x0
+    , master_receive    = 0x1
+    , slave_transmit    = 0x2
+    , slave_receive     = 0x3
+    };
+
+enum sai_protocol_t
+    { i2s_protocol                  // fs low for left channel, one bit early
+    , left_justified_protocol       // fs high for left channel, aligned with msb
+    , tdm_protocol                  // one bit fs pulse before slot 0 (dsp short frame)
+    };
+
+enum sai_data_size_t
+    { data_8            = 0x2
+    , data_10           = 0x3
+    , data_16           = 0x4
+    , data_20           = 0x5
+    , data_24           = 0x6
+    , data_32           = 0x7
+    };
+
+enum sai_fifo_threshold_t
+    { fifo_empty            = 0x0
+    , fifo_quarter          = 0x1
+    , fifo_half             = 0x2
+    , fifo_three_quarters   = 0x3
+    , fifo_full             = 0x4
+    };
+
+template<sai_block_t> struct sai_block_traits {};
+
+#if defined(HAVE_PERIPHERAL_SAI)
+template<> struct sai_block_traits<block_a>
+{
+    typedef device::sai_t T;
+    static inline volatile uint32_t& CR1() { return device::SAI.ACR1; }
+    static inline volatile uint32_t& CR2() { return device::SAI.ACR2; }
+    static inline volatile uint32_t& FRCR() { return device::SAI.AFRCR; }
+    static inline volatile uint32_t& SLOTR() { return device::SAI.ASLOTR; }
+    static inline volatile uint32_t& IM() { return device::SAI.AIM; }
+    static inline volatile uint32_t& SR() { return device::SAI.ASR; }
+    static inline volatile uint32_t& CLRFR() { return device::SAI.ACLRFR; }
+    static inline volatile uint32_t& DR() { return device::SAI.ADR; }
+    static constexpr uint32_t CR1_EN = T::ACR1_SAIAEN;
+    static const gpio::internal::alternate_function_t sck = gpio::internal::SAI1_SCK_A;
+    static const gpio::internal::alternate_function_t fs = gpio::internal::SAI1_FS_A;
+    static const gpio::internal::alternate_function_t sd = gpio::internal::SAI1_SD_A;
+    static const gpio::internal::alternate_function_t mclk = gpio::internal::SAI1_MCLK_A;
+    static const uint8_t dma_request = dma::SAI1_A;
+};
+
+template<> struct sai_block_traits<block_b>
+{
+    typedef device::sai_t T;
+    static inline volatile uint32_t& CR1() { return device::SAI.BCR1; }
+    static inline volatile uint32_t& CR2() { return device::SAI.BCR2; }
+    static inline volatile uint32_t& FRCR() { return device::SAI.BFRCR; }
+    static inline volatile uint32_t& SLOTR() { return device::SAI.BSLOTR; }
+    static inline volatile uint32_t& IM() { return device::SAI.BIM; }
+    static inline volatile uint32_t& SR() { return device::SAI.BSR; }
+    static inline volatile uint32_t& CLRFR() { return device::SAI.BCLRFR; }
+    static inline volatile uint32_t& DR() { return device::SAI.BDR; }
+    static constexpr uint32_t CR1_EN = T::BCR1_SAIBEN;
+    static const gpio::internal::alternate_function_t sck = gpio::internal::SAI1_SCK_B;
+    static const gpio::internal::alternate_function_t fs = gpio::internal::SAI1_FS_B;
+    static const gpio::internal::alternate_function_t sd = gpio::internal::SAI1_SD_B;
+    static const gpio::internal::alternate_function_t mclk = gpio::internal::SAI1_MCLK_B;
+    static const uint8_t dma_request = dma::SAI1_B;
+};
+#endif
+
+//
+//  Common sub-block operations. Both sub-blocks share the register layout of
+//  block A, so the block A field definitions are used throughout. A sub-block
+//  must be disabled while it is configured, and dma must be set up before it
+//  is enabled. With synchronous sub-blocks, enable the slave before the
+//  master.
+//
+
+template<sai_block_t BLOCK>
+struct sai_subblock_t
+{
+    typedef typename sai_block_traits<BLOCK>::T _;
+    typedef sai_block_traits<BLOCK> __;
+
+    template
+        < sai_protocol_t        protocol
+        , sai_mode_t            mode
+        , sai_data_size_t       data_size
+        , uint8_t               nslots
+        , sai_fifo_threshold_t  threshold
+        , uint16_t              slots = (1 << nslots) - 1
+        >
+    static inline void configure(uint32_t clock)
+    {
+        static_assert(nslots > 0 && nslots <= (protocol == tdm_protocol ? 16 : 2), "invalid number of slots");
+        static_assert(protocol == tdm_protocol || nslots == 2, "I2S and left-justified frames have two slots");
+        static_assert(frame_bits<data_size, nslots>() <= 256, "SAI frame length exceeds 256 bits");
+
+        constexpr uint16_t frame = frame_bits<data_size, nslots>();
+
+        disable();
+
+        __::CR1() = _::ACR1_RESET_VALUE                                 // reset configuration register 1
+                  | _::template ACR1_MODE<mode>                         // master/slave, transmit/receive
+                  | _::template ACR1_PRTCFG<0x0>                        // free protocol
+                  | _::template ACR1_DS<data_size>                      // data size
+                  | _::ACR1_CKSTR                                       // drive on falling, sample on rising edge
+                  | clock                                               // synchronization and clock divider
+                  ;
+        __::CR2() = _::ACR2_RESET_VALUE                                 // reset configuration register 2
+                  | _::template ACR2_FTH<threshold>                     // fifo threshold
+                  | _::ACR2_FFLUS                                       // flush fifo
+                  ;
+        __::FRCR() = _::template AFRCR_FRL<frame - 1>                   // frame length
+                   | (protocol == tdm_protocol
+                     ? _::template AFRCR_FSALL<0>                       // one bit frame sync pulse
+                     | _::AFRCR_FSPOL                                   // active high
+                     | _::AFRCR_FSOFF                                   // one bit before slot 0
+                     : _::template AFRCR_FSALL<frame / 2 - 1>           // frame sync for half frame
+                     | _::AFRCR_FSDEF                                   // channel identification
+                     | (protocol == i2s_protocol
+                       ? _::AFRCR_FSOFF                                 // active low, one bit before msb
+                       : _::AFRCR_FSPOL))                               // active high, aligned with msb
+                   ;
+        __::SLOTR() = _::ASLOTR_RESET_VALUE                             // reset slot register
+                    | _::template ASLOTR_SLOTSZ<slot_size<data_size>()> // slot size
+                    | _::template ASLOTR_NBSLOT<nslots - 1>             // number of slots
+                    | _::template ASLOTR_SLOTEN<slots>                  // enabled slots
+                    ;
+        __::IM() = _::AIM_RESET_VALUE;                                  // disable interrupts
+        __::CLRFR() = _::ACLRFR_LFSDET | _::ACLRFR_CAFSDET | _::ACLRFR_CNRDY  // clear all flags
+                    | _::ACLRFR_WCKCFG | _::ACLRFR_MUTEDET | _::ACLRFR_OVRUDR
+                    ;
+    }
+
+    static inline void enable()
+    {
+        __::CR1() |= __::CR1_EN;                                        // enable sub-block
+    }
+
+    static inline void disable()
+    {
+        __::CR1() &= ~__::CR1_EN;                                       // disable sub-block
+        while (__::CR1() & __::CR1_EN);                                 // takes effect at end of frame
+    }
+
+    template<typename DMA, uint8_t DMACH, typename T>
+    static inline void enable_dma(const T *source, uint16_t nelem)
+    {
+        DMA::template disable<DMACH>();                                 // disable dma channel
+        DMA::template mem_to_periph<DMACH, T, dma::dma_type_size<T>()>(source, nelem, &__::DR());
+        DMA::template request<DMACH, __::dma_request>();                // route sai request
+        DMA::template enable<DMACH>();                                  // enable dma channel
+        __::CR1() |= _::ACR1_DMAEN;                                     // enable sai dma requests
+    }
+
+    template<typename DMA, uint8_t DMACH, typename T>
+    static inline void enable_rx_dma(T *dest, uint16_t nelem)
+    {
+        DMA::template disable<DMACH>();                                 // disable dma channel
+        DMA::template periph_to_mem<DMACH, T, dma::dma_type_size<T>()>(&__::DR(), dest, nelem);
+        DMA::template request<DMACH, __::dma_request>();                // route sai request
+        DMA::template enable<DMACH>();                                  // enable dma channel
+        __::CR1() |= _::ACR1_DMAEN;                                     // enable sai dma requests
+    }
+
+    static inline void write(uint32_t x)
+    {
+        while ((__::SR() & _::template ASR_FLVL<0x7>) == _::template ASR_FLVL<0x5>);   // wait while fifo full
+        __::DR() = x;
+    }
+
+    static inline uint32_t read()
+    {
+        while (!(__::SR() & _::template ASR_FLVL<0x7>));                // wait while fifo empty
+        return __::DR();
+    }
+
+    static inline bool overrun_underrun()
+    {
+        bool x = __::SR() & _::ASR_OVRUDR;
+
+        __::CLRFR() = _::ACLRFR_OVRUDR;
+        return x;
+    }
+
+    template<sai_data_size_t data_size>
+    static constexpr uint8_t slot_size()
+    {
+        return data_size <= data_16 ? 0x1 : 0x2;                        // 16 or 32-bit slots
+    }
+
+    template<sai_data_size_t data_size, uint8_t nslots>
+    static constexpr uint16_t frame_bits()
+    {
+        return (slot_size<data_size>() == 0x1 ? 16 : 32) * nslots;
+    }
+};
+
+//
+//  Asynchronous sub-block with its own clock and frame sync pins. As master
+//  it derives the bit clock from the sai kernel clock (system clock at reset)
+//  with the master clock divider, optionally with a 256 x fs master clock
+//  output on the MCLK pin (requires a power of two frame length).
+//
+
+template<sai_block_t BLOCK, gpio_pin_t SCK, gpio_pin_t FS, gpio_pin_t SD>
+struct sai_t: public sai_subblock_t<BLOCK>
+{
+    typedef sai_subblock_t<BLOCK> base;
+    typedef typename base::_ _;
+    typedef typename base::__ __;
+
+    template
+        < sai_protocol_t        protocol
+        , sai_mode_t            mode
+        , sai_data_size_t       data_size
+        , uint32_t              sample_freq
+        , uint8_t               nslots = 2
+        , sai_fifo_threshold_t  threshold = fifo_half
+        , output_speed_t        speed = high_speed
+        >
+    static inline void setup()
+    {
+        using namespace gpio::internal;
+
+        alternate_t<SCK, __::sck>::template setup<speed>();
+        alternate_t<FS, __::fs>::template setup<speed>();
+        alternate_t<SD, __::sd>::template setup<speed>();
+
+        device::peripheral_traits<_>::enable();                                 // enable sai clock
+
+        constexpr uint16_t frame = base::template frame_bits<data_size, nslots>();
+        const uint32_t mckdiv = (sys_clock::freq() + sample_freq * frame / 2) / (sample_freq * frame);
+
+        base::template configure<protocol, mode, data_size, nslots, threshold>
+            ( _::ACR1_NODIV                                             // bit clock directly from divider
+            | (mode == master_transmit || mode == master_receive
+              ? ((mckdiv > 63 ? 63 : mckdiv) << 20)                     // master clock divider
+              : 0)
+            );
+    }
+
+    template
+        < sai_protocol_t        protocol
+        , sai_mode_t            mode
+        , sai_data_size_t       data_size
+        , uint32_t              sample_freq
+        , gpio_pin_t            MCLK
+        , uint8_t               nslots = 2
+        , sai_fifo_threshold_t  threshold = fifo_half
+        , output_speed_t        speed = high_speed
+        >
+    static inline void setup_with_mclk()
+    {
+        using namespace gpio::internal;
+
+        constexpr uint16_t frame = base::template frame_bits<data_size, nslots>();
+
+        static_assert(mode == master_transmit || mode == master_receive, "master clock output requires master mode");
+        static_assert((frame & (frame - 1)) == 0 && frame >= 8, "master clock output requires power of two frame length");
+
+        alternate_t<SCK, __::sck>::template setup<speed>();
+        alternate_t<FS, __::fs>::template setup<speed>();
+        alternate_t<SD, __::sd>::template setup<speed>();
+        alternate_t<MCLK, __::mclk>::template setup<speed>();
+
+        device::peripheral_traits<_>::enable();                                 // enable sai clock
+
+        const uint32_t mckdiv = (sys_clock::freq() + sample_freq * 128) / (sample_freq * 256);
+
+        base::template configure<protocol, mode, data_size, nslots, threshold>
+            ( _::ACR1_MCKEN                                             // master clock output enable
+            | ((mckdiv > 63 ? 63 : mckdiv) << 20)                       // master clock divider
+            );
+    }
+};
+
+//
+//  Synchronous sub-block, clocked by the other sub-block of the same sai
+//  (which must be configured first); only the data pin is used.
+//
+
+template<sai_block_t BLOCK, gpio_pin_t SD>
+struct sai_sync_t: public sai_subblock_t<BLOCK>
+{
+    typedef sai_subblock_t<BLOCK> base;
+    typedef typename base::_ _;
+    typedef typename base::__ __;
+
+    template
+        < sai_protocol_t        protocol
+        , sai_mode_t            mode
+        , sai_data_size_t       data_size
+        , uint8_t               nslots = 2
+        , sai_fifo_threshold_t  threshold = fifo_half
+        , output_speed_t        speed = high_speed
+        >
+    static inline void setup()
+    {
+        using namespace gpio::internal;
+
+        static_assert(mode == slave_transmit || mode == slave_receive, "synchronous sub-block must be a slave");
+
+        alternate_t<SD, __::sd>::template setup<speed>();
+
+        device::peripheral_traits<_>::enable();                                 // enable sai clock
+
+        base::template configure<protocol, mode, data_size, nslots, threshold>
+            ( _::template ACR1_SYNCEN<0x1>                              // synchronous with other sub-block
+            );
+    }
+};
+
+} // namespace sai
+
+} // namespace hal
+
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <timer.h>
+
+namespace hal
+{
+
+namespace timer
+{
+
+//
+//  A software timer is owned by the caller and must stay alive while it is
+//  scheduled. The deadline is in timebase ticks, a non-zero period re-arms
+//  the timer relative to its previous deadline (no drift). The callback runs
+//  in interrupt context and may start or cancel any timer, including itself.
+//  Call scheduler_t::init once before the first start.
+//
+struct sw_timer_t
+{
+    typedef void (*callback_t)(sw_timer_t *t);
+
+    uint64_t                deadline;               // absolute expiry in timebase ticks
+    uint64_t                period;                 // re-arm interval, 0 for one-shot
+    callback_t              callback;               // invoked on expiry
+    void                    *context;               // user data
+
+    // owned by the scheduler
+
+    sw_timer_t              *next;
+    sw_timer_t              *prev;
+    uint8_t                 level;                  // wheel level or inactive
+    uint8_t                 slot;
+};
+
+//
+//  Tickless scheduler multiplexing any number of software timers on one
+//  compare channel of a timebase timer. Timers live in a hierarchical wheel
+//  of 4 levels by 64 slots, the unit of level 0 being 2^RES ticks. Insert and
+//  cancel are O(1), occupancy bitmaps find the next busy slot without walking
+//  empty ones, and the compare register is set to the next expiry or cascade
+//  point. Timers beyond the wheel horizon wait in the last slot of the top
+//  level and are re-inserted when it is reached. Call isr() from the timer
+//  interrupt handler (it also services the timebase update).
+//
+template<int TN, channel_t CH, uint32_t FREQ = timer_kernel_clock, uint8_t RES = 0>
+class scheduler_t
+{
+public:
+    typedef timebase_t<TN, FREQ> timebase;
+
+    static void setup()
+    {
+        for (uint8_t l = 0; l < levels; ++l)
+        {
+            s_occupied[l] = 0;
+            for (uint8_t i = 0; i < slots; ++i)
+                s_wheel[l][i] = 0;
+        }
+
+        timebase::setup();
+        s_now = timebase::now() >> RES;
+        __::CCMR() &= ~__::template CCMR_OCM<0x7>;              // frozen output compare
+        tim::TIM().SR = ~(_::SR_CC1IF << CH);
+        tim::TIM().DIER |= _::DIER_CC1IE << CH;                 // compare interrupt
+    }
+
+    static void start(sw_timer_t *t, uint64_t deadline, uint64_t period = 0)
+    {
+        critical_section_t cs;
+
+        if (t->level != inactive)
+            unlink(t);
+        t->deadline = deadline;
+        t->period = period;
+        insert(t);
+        reschedule();
+    }
+
+    static void start_in(sw_timer_t *t, uint64_t delay, uint64_t period = 0)
+    {
+        start(t, timebase::now() + delay, period);
+    }
+
+    static void cancel(sw_timer_t *t)
+    {
+        critical_section_t cs;
+
+        if (t->level != inactive)
+            unlink(t);
+    }
+
+    static bool active(const sw_timer_t *t)
+    {
+        return t->level != inactive;
+    }
+
+    static void init(sw_timer_t *t, sw_timer_t::callback_t callback, void *context = 0)
+    {
+        t->callback = callback;
+        t->context = context;
+        t->level = inactive;
+    }
+
+    static void isr()
+    {
+        timebase::isr();
+        if (tim::TIM().SR & (_::SR_CC1IF << CH))
+        {
+            tim::TIM().SR = ~(_::SR_CC1IF << CH);               // no read-modify-write, keeps UIF
+            run();
+        }
+    }
+
+private:
+    typedef timer_t<TN> tim;
+    typedef typename tim::_ _;
+    typedef timer_channel_traits<CH, tim> __;
+
+    static constexpr uint8_t levels = 4;
+    static constexpr uint8_t bits = 6;
+    static constexpr uint8_t slots = 1 << bits;
+    static constexpr uint8_t inactive = 0xff;
+
+    static inline uint64_t unit(uint64_t ticks)                 // round up to wheel unit
+    {
+        return (ticks + (1ull << RES) - 1) >> RES;
+    }
+
+    static void insert(sw_timer_t *t)
+    {
+        uint64_t e = unit(t->deadline);
+        uint8_t l = 0;
+
+        if (e < s_now)
+            e = s_now;                                          // overdue, expire on next run
+        while (l < levels - 1 && (e >> (bits * l)) - (s_now >> (bits * l)) >= slots)
+            ++l;
+        if ((e >> (bits * l)) - (s_now >> (bits * l)) >= slots) // beyond horizon
+            e = ((s_now >> (bits * l)) + slots - 1) << (bits * l);
+
+        uint8_t i = (e >> (bits * l)) & (slots - 1);
+
+        t->level = l;
+        t->slot = i;
+        t->prev = 0;
+        t->next = s_wheel[l][i];
+        if (t->next)
+            t->next->prev = t;
+        s_wheel[l][i] = t;
+        s_occupied[l] |= 1ull << i;
+    }
+
+    static void unlink(sw_timer_t *t)
+    {
+        if (t->prev)
+            t->prev->next = t->next;
+        else
+            s_wheel[t->level][t->slot] = t->next;
+        if (t->next)
+            t->next->prev = t->prev;
+        if (!s_wheel[t->level][t->slot])
+            s_occupied[t->level] &= ~(1ull << t->slot);
+        t->level = inactive;
+    }
+
+    // Detach each busy slot passed since the last run and either fire its
+    // timers or re-insert them closer to expiry. A detached list is walked
+    // once, so re-insertions into the same slot wait for the next run.
+
+    static void run()
+    {
+        uint64_t now = timebase::now(), n = now >> RES, last = s_now;
+
+        s_now = n;                                              // re-insert relative to now
+        for (uint8_t l = 0; l < levels; ++l)
+        {
+            uint64_t from = last >> (bits * l), to = n >> (bits * l);
+            uint64_t mask = to - from >= slots - 1 ? ~0ull : span(from & (slots - 1), to - from + 1);
+
+            while (s_occupied[l] & mask)
+            {
+                uint8_t i = __builtin_ctzll(s_occupied[l] & mask);
+                sw_timer_t *t = s_wheel[l][i];
+
+                mask &= ~(1ull << i);
+                s_wheel[l][i] = 0;
+                s_occupied[l] &= ~(1ull << i);
+
+                while (t)
+                {
+                    sw_timer_t *next = t->next;
+
+                    t->level = inactive;
+                    if (t->deadline <= now)
+                        expire(t);
+                    else
+                        insert(t);
+                    t = next;
+                }
+            }
+        }
+
+        reschedule();
+    }
+
+    static void expire(sw_timer_t *t)
+    {
+        if (t->period)
+        {
+            t->deadline += t->period;
+            insert(t);
+        }
+        t->callback(t);
+    }
+
+    static inline uint64_t span(uint8_t first, uint8_t count)  // slots first .. first + count - 1 mod 64
+    {
+        uint64_t m = (1ull << count) - 1;
+
+        return first ? (m << first) | (m >> (slots - first)) : m;
+    }
+
+    // Program the compare register with the start of the nearest busy slot
+    // over all levels, capped at half a counter period so the low bits are
+    // unambiguous. If that time has already passed, force a compare event.
+
+    static void reschedule()
+    {
+        uint64_t wake = ~0ull;
+
+        for (uint8_t l = 0; l < levels; ++l)
+        {
+            uint64_t m = s_occupied[l];
+
+            if (!m)
+                continue;
+
+            uint8_t cur = (s_now >> (bits * l)) & (slots - 1);
+            uint64_t r = cur ? (m >> cur) | (m << (slots - cur)) : m;
+            uint64_t w = ((s_now >> (bits * l)) + __builtin_ctzll(r)) << (bits * l);
+
+            if (w < wake)
+                wake = w;
+        }
+
+        if (wake == ~0ull)
+            return;
+
+        uint64_t now = timebase::now(), at = wake << RES;
+
+        if (at > now + max_span)
+            at = now + max_span;
+        __::CCR() = static_cast<typename tim::count_t>(at);
+        if (timebase::now() >= at)
+            tim::TIM().EGR = _::EGR_CC1G << CH;                 // already due
+    }
+
+    static constexpr uint64_t max_span = static_cast<uint64_t>(static_cast<typename tim::count_t>(~0)) / 2;
+
+    static sw_timer_t   *s_wheel[levels][slots];
+    static uint64_t     s_occupied[levels];
+    static uint64_t     s_now;                                  // wheel time in units
+};
+
+template<int TN, channel_t CH, uint32_t FREQ, uint8_t RES>
+sw_timer_t *scheduler_t<TN, CH, FREQ, RES>::s_wheel[levels][slots];
+
+template<int TN, channel_t CH, uint32_t FREQ, uint8_t RES>
+uint64_t scheduler_t<TN, CH, FREQ, RES>::s_occupied[levels];
+
+template<int TN, channel_t CH, uint32_t FREQ, uint8_t RES>
+uint64_t scheduler_t<TN, CH, FREQ, RES>::s_now;
+
+} // namespace timer
+
+} // namespace hal
+
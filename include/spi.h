@@ -1,6 +1,7 @@
 #pragma once
 
 #include <gpio.h>
+#include "dma.h"
 
 namespace hal
 {
@@ -11,6 +12,10 @@ namespace spi
 using namespace device;
 using namespace gpio;
 
+#if defined(STM32F0) || defined(STM32F7) || defined(STM32G0) || defined(STM32G4)
+#define HAVE_SPI_FIFO                                           // DS, FRXTH and packing support
+#endif
+
 enum spi_mode_t
     { mode_0    // CPOL=0, CPHA=0
     , mode_1    // CPOL=0, CPHA=1
@@ -41,6 +46,27 @@ template<> struct spi_traits<1>
     static const gpio::internal::alternate_function_t mosi = gpio::internal::SPI1_MOSI;
     static const gpio::internal::alternate_function_t miso = gpio::internal::SPI1_MISO;
     static const gpio::internal::alternate_function_t nss = gpio::internal::SPI1_NSS;
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_tx_request = dma::SPI1_TX;
+    static const uint8_t dma_rx_request = dma::SPI1_RX;
+#elif defined(STM32F4) || defined(STM32F7)
+    static const uint8_t dma_tx_request = 3;                // stream channel selection
+    static const uint8_t dma_rx_request = 3;                // stream channel selection
+#else
+    static const uint8_t dma_tx_request = 0;                // fixed dma mapping
+    static const uint8_t dma_rx_request = 0;                // fixed dma mapping
+#endif
+
+    static inline void reset()                                  // pulse peripheral reset
+    {
+#if defined(STM32G0)
+        RCC.APBRSTR2 |= rcc_t::APBRSTR2_SPI1RST;
+        RCC.APBRSTR2 &= ~rcc_t::APBRSTR2_SPI1RST;
+#else
+        RCC.APB2RSTR |= rcc_t::APB2RSTR_SPI1RST;
+        RCC.APB2RSTR &= ~rcc_t::APB2RSTR_SPI1RST;
+#endif
+    }
 };
 
 template<> struct spi_traits<2>
@@ -51,6 +77,30 @@ template<> struct spi_traits<2>
     static const gpio::internal::alternate_function_t mosi = gpio::internal::SPI2_MOSI;
     static const gpio::internal::alternate_function_t miso = gpio::internal::SPI2_MISO;
     static const gpio::internal::alternate_function_t nss = gpio::internal::SPI2_NSS;
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_tx_request = dma::SPI2_TX;
+    static const uint8_t dma_rx_request = dma::SPI2_RX;
+#elif defined(STM32F4) || defined(STM32F7)
+    static const uint8_t dma_tx_request = 0;                // stream channel selection
+    static const uint8_t dma_rx_request = 0;                // stream channel selection
+#else
+    static const uint8_t dma_tx_request = 0;                // fixed dma mapping
+    static const uint8_t dma_rx_request = 0;                // fixed dma mapping
+#endif
+
+    static inline void reset()                                  // pulse peripheral reset
+    {
+#if defined(STM32G0)
+        RCC.APBRSTR1 |= rcc_t::APBRSTR1_SPI2RST;
+        RCC.APBRSTR1 &= ~rcc_t::APBRSTR1_SPI2RST;
+#elif defined(STM32G4)
+        RCC.APB1RSTR1 |= rcc_t::APB1RSTR1_SPI2RST;
+        RCC.APB1RSTR1 &= ~rcc_t::APB1RSTR1_SPI2RST;
+#else
+        RCC.APB1RSTR |= rcc_t::APB1RSTR_SPI2RST;
+        RCC.APB1RSTR &= ~rcc_t::APB1RSTR_SPI2RST;
+#endif
+    }
 };
 
 #if defined(HAVE_PERIPHERAL_SPI3)
@@ -62,6 +112,27 @@ template<> struct spi_traits<3>
     static const gpio::internal::alternate_function_t mosi = gpio::internal::SPI3_MOSI;
     static const gpio::internal::alternate_function_t miso = gpio::internal::SPI3_MISO;
     static const gpio::internal::alternate_function_t nss = gpio::internal::SPI3_NSS;
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_tx_request = dma::SPI3_TX;
+    static const uint8_t dma_rx_request = dma::SPI3_RX;
+#elif defined(STM32F4) || defined(STM32F7)
+    static const uint8_t dma_tx_request = 0;                // stream channel selection
+    static const uint8_t dma_rx_request = 0;                // stream channel selection
+#else
+    static const uint8_t dma_tx_request = 0;                // fixed dma mapping
+    static const uint8_t dma_rx_request = 0;                // fixed dma mapping
+#endif
+
+    static inline void reset()                                  // pulse peripheral reset
+    {
+#if defined(STM32G4)
+        RCC.APB1RSTR1 |= rcc_t::APB1RSTR1_SPI3RST;
+        RCC.APB1RSTR1 &= ~rcc_t::APB1RSTR1_SPI3RST;
+#else
+        RCC.APB1RSTR |= rcc_t::APB1RSTR_SPI3RST;
+        RCC.APB1RSTR &= ~rcc_t::APB1RSTR_SPI3RST;
+#endif
+    }
 };
 #endif
 
@@ -91,7 +162,62 @@ template<> struct spi_mode_traits<mode_3>
     static constexpr uint32_t mode() { return _::CR1_CPHA | _::CR1_CPOL; }
 };
 
-template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI> struct spi_t
+//
+//  Frame size: 4 to 16 bits on spi with fifo (DS field, with FRXTH set for
+//  frames up to 8 bits so rxne follows single frames) and 8 or 16 bits (DFF)
+//  on the older spi without.
+//
+template<uint8_t BITS> struct spi_data_size_traits
+{
+#if defined(HAVE_SPI_FIFO)
+    static_assert(BITS >= 4 && BITS <= 16, "spi frame size must be 4 to 16 bits");
+
+    template<typename _>
+    static constexpr uint32_t cr1() { return 0; }
+
+    template<typename _>
+    static constexpr uint32_t cr2() { return _::template CR2_DS<BITS - 1> | (BITS <= 8 ? _::CR2_FRXTH : 0); }
+
+    template<typename _>
+    static constexpr uint32_t cr2_mask() { return _::template CR2_DS<0xf> | _::CR2_FRXTH; }
+#else
+    static_assert(BITS == 8 || BITS == 16, "spi frame size must be 8 or 16 bits");
+
+    template<typename _>
+    static constexpr uint32_t cr1() { return BITS == 16 ? _::CR1_DFF : 0; }
+
+    template<typename _>
+    static constexpr uint32_t cr2() { return 0; }
+
+    template<typename _>
+    static constexpr uint32_t cr2_mask() { return 0; }
+#endif
+};
+
+static constexpr gpio_pin_t no_pin = static_cast<gpio_pin_t>(0xff);  // unconnected pin
+
+template<int NO, gpio_pin_t PIN> struct miso_traits
+{
+    template<output_speed_t speed>
+    static inline void setup()
+    {
+        using namespace gpio::internal;
+
+#if defined(STM32F103)
+        alternate_t<PIN, spi_traits<NO>::miso>::template setup<floating>();
+#else
+        alternate_t<PIN, spi_traits<NO>::miso>::template setup<speed>();
+#endif
+    }
+};
+
+template<int NO> struct miso_traits<NO, no_pin>
+{
+    template<output_speed_t speed>
+    static inline void setup() {}                               // transmit-only
+};
+
+template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO = no_pin> struct spi_t
 {
 private:
     typedef typename spi_traits<NO>::T _;
@@ -102,6 +228,7 @@ public:
         , spi_bit_order_t       order   = msb_first
         , spi_clock_divider_t   divider = fpclk_256
         , output_speed_t        speed   = low_speed
+        , uint8_t               bits    = 8
         >
     static inline void setup()
     {
@@ -109,6 +236,7 @@ public:
 
         alternate_t<SCK, spi_traits<NO>::sck>::template setup<speed>();
         alternate_t<MOSI, spi_traits<NO>::mosi>::template setup<speed>();
+        miso_traits<NO, MISO>::template setup<speed>();
 
         peripheral_traits<_>::enable();                         // enable spi clock
         SPI().CR1 = _::CR1_RESET_VALUE                          // reset control register 1
@@ -116,9 +244,27 @@ public:
                   | _::template CR1_BR<divider>                 // clock divider
                   | spi_mode_traits<mode>::template mode<_>()   // SPI-mode
                   | (order == lsb_first ?  _::CR1_LSBFIRST : 0) // lsb first
+                  | spi_data_size_traits<bits>::template cr1<_>()   // frame size (DFF)
                   ;
         SPI().CR2 = _::CR2_RESET_VALUE;         // reset control register 2
+        SPI().CR2 &= ~spi_data_size_traits<bits>::template cr2_mask<_>();   // reset value has DS set
         SPI().CR2 |= _::CR2_SSOE;               // ss output enable
+        SPI().CR2 |= spi_data_size_traits<bits>::template cr2<_>(); // frame size and rx threshold
+        SPI().CR1 |= _::CR1_SPE;                // enable spi
+    }
+
+    template<uint8_t bits>
+    static void data_size()                     // change frame size between transfers
+    {
+        wait_idle();
+        SPI().CR1 &= ~_::CR1_SPE;               // disable spi
+#if defined(HAVE_SPI_FIFO)
+        SPI().CR2 &= ~(_::template CR2_DS<0xf> | _::CR2_FRXTH);
+#else
+        SPI().CR1 &= ~_::CR1_DFF;
+#endif
+        SPI().CR1 |= spi_data_size_traits<bits>::template cr1<_>();
+        SPI().CR2 |= spi_data_size_traits<bits>::template cr2<_>();
         SPI().CR1 |= _::CR1_SPE;                // enable spi
     }
 
@@ -136,6 +282,59 @@ public:
         SPI().DR = x;
     }
 
+    static inline uint8_t transfer8(uint8_t x = 0xff)
+    {
+        write8(x);
+        while (!(SPI().SR & _::SR_RXNE));       // wait until rx buffer is not empty
+        return *reinterpret_cast<volatile uint8_t*>(&SPI().DR);
+    }
+
+    static inline uint16_t transfer16(uint16_t x = 0xffff)
+    {
+        write16(x);
+        while (!(SPI().SR & _::SR_RXNE));       // wait until rx buffer is not empty
+        return SPI().DR;
+    }
+
+    static void transfer(const uint8_t *tx, uint8_t *rx, uint16_t n)    // polled full-duplex
+    {
+        for (uint16_t i = 0; i < n; ++i)
+            rx[i] = transfer8(tx ? tx[i] : 0xff);
+    }
+
+#if defined(HAVE_SPI_FIFO)
+    // packed access for frames up to 8 bits: two frames per 16-bit data
+    // register access, halving the number of bus accesses for byte streams
+
+    static void write_packed(const uint8_t *buf, uint16_t n)
+    {
+        for (; n > 1; n -= 2, buf += 2)
+        {
+            while (!(SPI().SR & _::SR_TXE));    // wait until tx fifo half empty
+            DR16() = buf[0] | (buf[1] << 8);    // two frames, first in low byte
+        }
+        if (n)
+            write8(*buf);
+    }
+
+    static void transfer_packed(const uint8_t *tx, uint8_t *rx, uint16_t n)
+    {
+        SPI().CR2 &= ~_::CR2_FRXTH;             // rxne on 16-bit fifo level
+        for (; n > 1; n -= 2, tx += 2, rx += 2)
+        {
+            while (!(SPI().SR & _::SR_TXE));    // wait until tx fifo half empty
+            DR16() = tx[0] | (tx[1] << 8);      // two frames, first in low byte
+            while (!(SPI().SR & _::SR_RXNE));   // wait for two frames
+            uint16_t x = DR16();
+            rx[0] = x;
+            rx[1] = x >> 8;
+        }
+        SPI().CR2 |= _::CR2_FRXTH;              // back to 8-bit fifo level
+        if (n)
+            *rx = transfer8(*tx);
+    }
+#endif
+
     __attribute__((always_inline))
     static inline bool busy()
     {
@@ -164,8 +363,527 @@ public:
 
 private:
     static inline typename spi_traits<NO>::T& SPI() { return spi_traits<NO>::SPI(); }
+    static inline volatile uint16_t& DR16() { return *reinterpret_cast<volatile uint16_t*>(&SPI().DR); }
 };
 
+//
+//  Bulk transfers by dma on an spi set up by spi_t. Completion is detected on
+//  the receive channel for full-duplex and receive-only transfers and on the
+//  transmit channel for transmit-only transfers; the isr then waits for the
+//  shift register to drain, flushes stale receive data and invokes the
+//  callback. Call isr from the handlers of both dma channels. Receive-only
+//  transfers clock out 0xff filler.
+//
+template<int NO, typename DMA, uint8_t TXCH, uint8_t RXCH>
+class spi_dma_t
+{
+public:
+    typedef void (*callback_t)();
+
+    static void setup()
+    {
+        DMA::setup();
+        m_busy = false;
+    }
+
+    template<typename T>
+    static void transfer(const T *tx, T *rx, uint16_t n, callback_t cb = 0)
+    {
+        start(cb, true);
+        start_rx(rx, n);
+        start_tx<T, dma::memory_increment>(tx, n);
+    }
+
+    template<typename T>
+    static void write(const T *tx, uint16_t n, callback_t cb = 0)
+    {
+        start(cb, false);
+        start_tx<T, dma::memory_increment>(tx, n);
+    }
+
+    template<typename T>
+    static void read(T *rx, uint16_t n, callback_t cb = 0)
+    {
+        start(cb, true);
+        start_rx(rx, n);
+        start_tx<T, dma::memory_fixed>(reinterpret_cast<const T*>(&m_filler), n);
+    }
+
+#if defined(HAVE_SPI_FIFO)
+    // packed variants for frames up to 8 bits: two frames per 16-bit dma
+    // access with LDMA_TX/RX handling an odd count, buffers must be 16-bit
+    // aligned and the receive buffer must have room for an even count
+
+    static void transfer_packed(const uint8_t *tx, uint8_t *rx, uint16_t n, callback_t cb = 0)
+    {
+        start(cb, true);
+        pack(n, _::CR2_LDMA_TX | _::CR2_LDMA_RX);
+        start_rx(reinterpret_cast<uint16_t*>(rx), (n + 1) >> 1);
+        start_tx<uint16_t, dma::memory_increment>(reinterpret_cast<const uint16_t*>(tx), (n + 1) >> 1);
+    }
+
+    static void write_packed(const uint8_t *tx, uint16_t n, callback_t cb = 0)
+    {
+        start(cb, false);
+        pack(n, _::CR2_LDMA_TX);
+        start_tx<uint16_t, dma::memory_increment>(reinterpret_cast<const uint16_t*>(tx), (n + 1) >> 1);
+    }
+
+    static void read_packed(uint8_t *rx, uint16_t n, callback_t cb = 0)
+    {
+        start(cb, true);
+        pack(n, _::CR2_LDMA_TX | _::CR2_LDMA_RX);
+        start_rx(reinterpret_cast<uint16_t*>(rx), (n + 1) >> 1);
+        start_tx<uint16_t, dma::memory_fixed>(&m_filler, (n + 1) >> 1);
+    }
+#endif
+
+    static inline bool busy() { return m_busy; }
+
+    static void isr()
+    {
+        constexpr uint32_t done = dma::dma_transfer_complete | dma::dma_transfer_error;
+
+        if (!m_busy)
+            return;
+
+        if (m_wait_rx)
+        {
+            if (!(DMA::template interrupt_status<RXCH>() & done))
+                return;
+        }
+        else if (!(DMA::template interrupt_status<TXCH>() & done))
+            return;
+
+        DMA::template abort<RXCH>();
+        DMA::template abort<TXCH>();
+        wait_idle();                                            // let last frame shift out
+        SPI().CR2 &= ~(_::CR2_TXDMAEN | _::CR2_RXDMAEN);        // disable dma requests
+#if defined(HAVE_SPI_FIFO)
+        if (m_packed)
+        {
+            SPI().CR2 &= ~(_::CR2_LDMA_TX | _::CR2_LDMA_RX);    // clear odd count
+            SPI().CR2 |= _::CR2_FRXTH;                          // back to 8-bit fifo level
+            m_packed = false;
+        }
+#endif
+        flush_rx();                                             // discard (transmit-only) data
+        m_busy = false;
+        if (m_cb)
+            m_cb();
+    }
+
+private:
+    typedef typename spi_traits<NO>::T _;
+    static inline typename spi_traits<NO>::T& SPI() { return spi_traits<NO>::SPI(); }
+
+    static void start(callback_t cb, bool wait_rx)
+    {
+        while (m_busy);                                         // previous transfer in progress
+        m_busy = true;
+        m_cb = cb;
+        m_wait_rx = wait_rx;
+        DMA::template disable<RXCH>();
+        DMA::template disable<TXCH>();
+        flush_rx();
+    }
+
+#if defined(HAVE_SPI_FIFO)
+    static void pack(uint16_t n, uint32_t ldma)
+    {
+        m_packed = true;
+        SPI().CR2 &= ~(_::CR2_FRXTH | _::CR2_LDMA_TX | _::CR2_LDMA_RX);
+        if (n & 1)
+            SPI().CR2 |= ldma;                                  // last access is a single frame
+    }
+#endif
+
+    template<typename T>
+    static void start_rx(T *rx, uint16_t n)
+    {
+        DMA::template periph_to_mem<RXCH, T, dma::dma_type_size<T>(), dma::linear>(&SPI().DR, rx, n);
+        DMA::template request<RXCH, spi_traits<NO>::dma_rx_request>();
+        DMA::template enable_interrupt<RXCH>();
+        DMA::template enable<RXCH>();
+        SPI().CR2 |= _::CR2_RXDMAEN;                            // enable rx requests first
+    }
+
+    template<typename T, dma::increment_mode INC_MODE>
+    static void start_tx(const T *tx, uint16_t n)
+    {
+        DMA::template mem_to_periph<TXCH, T, dma::dma_type_size<T>(), dma::linear, INC_MODE>(tx, n, &SPI().DR);
+        DMA::template request<TXCH, spi_traits<NO>::dma_tx_request>();
+        if (!m_wait_rx)
+            DMA::template enable_interrupt<TXCH>();             // transmit-only completion
+        DMA::template enable<TXCH>();
+        SPI().CR2 |= _::CR2_TXDMAEN;                            // start transmission
+    }
+
+    static inline void wait_idle()
+    {
+#if defined(HAVE_SPI_FIFO)
+        while (SPI().SR & _::template SR_FTLVL<0x3>);           // wait for tx fifo empty
+#else
+        while (!(SPI().SR & _::SR_TXE));                        // wait for tx buffer empty
+#endif
+        while (SPI().SR & _::SR_BSY);                           // wait for last frame
+    }
+
+    static inline void flush_rx()
+    {
+        while (SPI().SR & _::SR_RXNE)                           // empty rx buffer (fifo)
+            static_cast<void>(*reinterpret_cast<volatile uint8_t*>(&SPI().DR));
+        static_cast<void>(SPI().SR);                            // clears overrun after dr read
+    }
+
+    static volatile bool    m_busy;
+    static bool             m_wait_rx;
+    static bool             m_packed;
+    static callback_t       m_cb;
+    static const uint16_t   m_filler;
+};
+
+template<int NO, typename DMA, uint8_t TXCH, uint8_t RXCH>
+volatile bool spi_dma_t<NO, DMA, TXCH, RXCH>::m_busy = false;
+
+template<int NO, typename DMA, uint8_t TXCH, uint8_t RXCH>
+bool spi_dma_t<NO, DMA, TXCH, RXCH>::m_wait_rx = false;
+
+template<int NO, typename DMA, uint8_t TXCH, uint8_t RXCH>
+bool spi_dma_t<NO, DMA, TXCH, RXCH>::m_packed = false;
+
+template<int NO, typename DMA, uint8_t TXCH, uint8_t RXCH>
+typename spi_dma_t<NO, DMA, TXCH, RXCH>::callback_t spi_dma_t<NO, DMA, TXCH, RXCH>::m_cb = 0;
+
+template<int NO, typename DMA, uint8_t TXCH, uint8_t RXCH>
+const uint16_t spi_dma_t<NO, DMA, TXCH, RXCH>::m_filler = 0xffff;
+
+//
+//  Slave with hardware NSS where a transaction is framed by NSS: while NSS is
+//  low the master clocks up to SIZE frames in both directions by dma, on the
+//  NSS rising edge the transaction ends. end_of_transaction must then be
+//  called (from the EXTI handler of the NSS pin, which setup enables on
+//  families where gpio supports pin interrupts). It stops the dma, resets the
+//  spi to flush stale frames from the transmit fifo, hands the received
+//  frames to the callback which prepares the response for the next
+//  transaction in place, and re-arms both channels. Dma channels run at very
+//  high priority so the slave keeps up at the maximum slave clock; the master
+//  must leave the callback time between transactions.
+//
+template
+    < int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO, gpio_pin_t NSS
+    , typename DMA, uint8_t TXCH, uint8_t RXCH
+    , uint16_t SIZE, typename T = uint8_t
+    >
+class spi_slave_t
+{
+public:
+    typedef void (*callback_t)(const T *rx, uint16_t n, T *tx);
+
+    template
+        < spi_mode_t        mode    = mode_0
+        , spi_bit_order_t   order   = msb_first
+        , uint8_t           bits    = 8 * sizeof(T)
+        >
+    static void setup(callback_t cb)
+    {
+        using namespace gpio::internal;
+
+        static_assert((bits <= 8) == (sizeof(T) == 1), "frame type does not match frame size");
+
+#if defined(STM32F103)
+        alternate_t<SCK, spi_traits<NO>::sck>::template setup<floating>();
+        alternate_t<MOSI, spi_traits<NO>::mosi>::template setup<floating>();
+        alternate_t<NSS, spi_traits<NO>::nss>::template setup<floating>();
+#else
+        alternate_t<SCK, spi_traits<NO>::sck>::template setup<high_speed>();
+        alternate_t<MOSI, spi_traits<NO>::mosi>::template setup<high_speed>();
+        alternate_t<NSS, spi_traits<NO>::nss>::template setup<high_speed>();
+#endif
+        alternate_t<MISO, spi_traits<NO>::miso>::template setup<high_speed>();
+
+        m_cb = cb;
+        m_cr1 = _::CR1_RESET_VALUE                              // slave mode, hardware nss
+              | spi_mode_traits<mode>::template mode<_>()       // SPI-mode
+              | (order == lsb_first ?  _::CR1_LSBFIRST : 0)     // lsb first
+              | spi_data_size_traits<bits>::template cr1<_>()   // frame size (DFF)
+              ;
+        m_cr2 = (_::CR2_RESET_VALUE & ~spi_data_size_traits<bits>::template cr2_mask<_>())
+              | spi_data_size_traits<bits>::template cr2<_>()   // frame size and rx threshold
+              ;
+
+        peripheral_traits<_>::enable();                         // enable spi clock
+        DMA::setup();
+        arm();
+
+#if defined(STM32G431) || defined(STM32F051)
+        input_t<NSS>::template enable_interrupt<rising_edge>(); // end of transaction
+#endif
+    }
+
+    static inline T *response() { return m_tx; }                // initial response
+
+    static void end_of_transaction()
+    {
+        DMA::template disable<RXCH>();
+        DMA::template disable<TXCH>();
+
+        uint16_t n = SIZE - DMA::template remaining<RXCH>();
+
+        spi_traits<NO>::reset();                                // only way to flush tx fifo
+        if (m_cb)
+            m_cb(m_rx, n, m_tx);                                // prepare next response
+        arm();
+    }
+
+private:
+    typedef typename spi_traits<NO>::T _;
+    static inline typename spi_traits<NO>::T& SPI() { return spi_traits<NO>::SPI(); }
+
+    static void arm()
+    {
+        SPI().CR1 = m_cr1;
+        SPI().CR2 = m_cr2 | _::CR2_RXDMAEN;                     // rx requests first
+
+        DMA::template periph_to_mem<RXCH, T, dma::dma_type_size<T>(), dma::linear>(&SPI().DR, m_rx, SIZE);
+        DMA::template request<RXCH, spi_traits<NO>::dma_rx_request>();
+        DMA::template priority<RXCH, 3>();
+        DMA::template enable<RXCH>();
+
+        DMA::template mem_to_periph<TXCH, T, dma::dma_type_size<T>(), dma::linear>(m_tx, SIZE, &SPI().DR);
+        DMA::template request<TXCH, spi_traits<NO>::dma_tx_request>();
+        DMA::template priority<TXCH, 3>();
+        DMA::template enable<TXCH>();
+
+        SPI().CR2 |= _::CR2_TXDMAEN;                            // preload transmit fifo
+        SPI().CR1 |= _::CR1_SPE;                                // enable spi
+    }
+
+    static T            m_rx[SIZE];
+    static T            m_tx[SIZE];
+    static callback_t   m_cb;
+    static uint32_t     m_cr1, m_cr2;
+};
+
+template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO, gpio_pin_t NSS, typename DMA, uint8_t TXCH, uint8_t RXCH, uint16_t SIZE, typename T>
+T spi_slave_t<NO, SCK, MOSI, MISO, NSS, DMA, TXCH, RXCH, SIZE, T>::m_rx[SIZE];
+
+template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO, gpio_pin_t NSS, typename DMA, uint8_t TXCH, uint8_t RXCH, uint16_t SIZE, typename T>
+T spi_slave_t<NO, SCK, MOSI, MISO, NSS, DMA, TXCH, RXCH, SIZE, T>::m_tx[SIZE];
+
+template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO, gpio_pin_t NSS, typename DMA, uint8_t TXCH, uint8_t RXCH, uint16_t SIZE, typename T>
+typename spi_slave_t<NO, SCK, MOSI, MISO, NSS, DMA, TXCH, RXCH, SIZE, T>::callback_t
+spi_slave_t<NO, SCK, MOSI, MISO, NSS, DMA, TXCH, RXCH, SIZE, T>::m_cb = 0;
+
+template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO, gpio_pin_t NSS, typename DMA, uint8_t TXCH, uint8_t RXCH, uint16_t SIZE, typename T>
+uint32_t spi_slave_t<NO, SCK, MOSI, MISO, NSS, DMA, TXCH, RXCH, SIZE, T>::m_cr1 = 0;
+
+template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO, gpio_pin_t NSS, typename DMA, uint8_t TXCH, uint8_t RXCH, uint16_t SIZE, typename T>
+uint32_t spi_slave_t<NO, SCK, MOSI, MISO, NSS, DMA, TXCH, RXCH, SIZE, T>::m_cr2 = 0;
+
+//
+//  Shared bus: several devices, each with its own chip-select pin, mode, bit
+//  order, clock divider and frame size, on one spi master. Transactions are
+//  queued and run back-to-back by dma from the completion interrupt; the
+//  control registers are only rewritten when the device changes. Chip-select
+//  is asserted for the duration of each transaction. Transactions are owned
+//  by the caller and must stay alive until done; a null tx sends 0xff filler
+//  and a null rx discards received frames, but one of them must be given
+//  or submit rejects the transaction. Call isr from the handlers of both
+//  dma channels.
+//
+
+struct spi_device_config_t
+{
+    uint32_t    cr1;                                            // mode, order, divider (and DFF)
+    uint32_t    cr2;                                            // frame size and rx threshold
+    bool        wide;                                           // frames over 8 bits
+    void        (*select)();
+    void        (*deselect)();
+};
+
+template
+    < gpio_pin_t            CS
+    , spi_mode_t            mode    = mode_0
+    , spi_bit_order_t       order   = msb_first
+    , spi_clock_divider_t   divider = fpclk_256
+    , uint8_t               bits    = 8
+    >
+struct spi_device_t
+{
+    template<typename _>
+    static constexpr spi_device_config_t config()
+    {
+        return spi_device_config_t
+            { _::template CR1_BR<divider>
+            | spi_mode_traits<mode>::template mode<_>()
+            | (order == lsb_first ?  _::CR1_LSBFIRST : 0)
+            | spi_data_size_traits<bits>::template cr1<_>()
+            , spi_data_size_traits<bits>::template cr2<_>()
+            , bits > 8
+            , select
+            , deselect
+            };
+    }
+
+    static void setup()
+    {
+        output_t<CS>::setup();
+        output_t<CS>::set();                                    // deselect
+    }
+
+    static void select() { output_t<CS>::clear(); }
+    static void deselect() { output_t<CS>::set(); }
+};
+
+struct spi_transaction_t
+{
+    typedef void (*callback_t)(spi_transaction_t *t);
+
+    const spi_device_config_t   *device;                        // from spi_bus_t::device
+    const void                  *tx;                            // frames to send or null
+    void                        *rx;                            // frames received or null
+    uint16_t                    n;                              // number of frames
+    callback_t                  callback;                       // invoked on completion, may be null
+    volatile bool               done;
+};
+
+template
+    < int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO
+    , typename DMA, uint8_t TXCH, uint8_t RXCH
+    , uint8_t QSIZE = 8
+    >
+class spi_bus_t
+{
+public:
+    template<output_speed_t speed = low_speed>
+    static void setup()
+    {
+        using namespace gpio::internal;
+
+        alternate_t<SCK, spi_traits<NO>::sck>::template setup<speed>();
+        alternate_t<MOSI, spi_traits<NO>::mosi>::template setup<speed>();
+        miso_traits<NO, MISO>::template setup<speed>();
+
+        peripheral_traits<_>::enable();                         // enable spi clock
+        dma::setup();
+        m_head = m_tail = 0;
+        m_current = 0;
+        m_device = 0;
+    }
+
+    template<typename DEVICE>
+    static const spi_device_config_t *device()                  // set up chip-select and get handle
+    {
+        static const spi_device_config_t config = DEVICE::template config<_>();
+
+        DEVICE::setup();
+        return &config;
+    }
+
+    static bool submit(spi_transaction_t *t)                    // false if queue is full or no buffers
+    {
+        critical_section_t cs;
+        uint8_t next = (m_tail + 1) % (QSIZE + 1);
+
+        if (next == m_head || (!t->tx && !t->rx))
+            return false;
+        t->done = false;
+        m_queue[m_tail] = t;
+        m_tail = next;
+        if (!m_current)
+            start_next();
+        return true;
+    }
+
+    static inline bool busy() { return m_current != 0; }
+
+    static inline void isr() { dma::isr(); }
+
+private:
+    typedef typename spi_traits<NO>::T _;
+    typedef spi_dma_t<NO, DMA, TXCH, RXCH> dma;
+    static inline typename spi_traits<NO>::T& SPI() { return spi_traits<NO>::SPI(); }
+
+    static void start_next()
+    {
+        if (m_head == m_tail)
+        {
+            m_current = 0;
+            return;
+        }
+
+        spi_transaction_t *t = m_current = m_queue[m_head];
+
+        m_head = (m_head + 1) % (QSIZE + 1);
+        configure(t->device);
+        t->device->select();
+        if (t->device->wide)
+            start<uint16_t>(t);
+        else
+            start<uint8_t>(t);
+    }
+
+    template<typename T>
+    static void start(spi_transaction_t *t)
+    {
+        if (!t->rx)
+            dma::write(static_cast<const T*>(t->tx), t->n, complete);
+        else if (!t->tx)
+            dma::read(static_cast<T*>(t->rx), t->n, complete);
+        else
+            dma::transfer(static_cast<const T*>(t->tx), static_cast<T*>(t->rx), t->n, complete);
+    }
+
+    static void configure(const spi_device_config_t *d)        // only on device change
+    {
+        if (d == m_device)
+            return;
+        m_device = d;
+        SPI().CR1 = _::CR1_RESET_VALUE;                         // disable to reconfigure
+        SPI().CR2 = (_::CR2_RESET_VALUE & ~spi_data_size_traits<8>::template cr2_mask<_>())
+                  | d->cr2                                      // frame size and rx threshold
+                  ;
+        SPI().CR1 = _::CR1_MSTR                                 // master mode
+                  | _::CR1_SSM                                  // software slave management
+                  | _::CR1_SSI                                  // internal slave select high
+                  | d->cr1                                      // device specific
+                  ;
+        SPI().CR1 |= _::CR1_SPE;                                // enable spi
+    }
+
+    static void complete()
+    {
+        spi_transaction_t *t = m_current;
+
+        t->device->deselect();
+        t->done = true;
+        start_next();                                           // keep the bus busy
+        if (t->callback)
+            t->callback(t);
+    }
+
+    static spi_transaction_t            *m_queue[QSIZE + 1];
+    static spi_transaction_t            *volatile m_current;
+    static const spi_device_config_t    *m_device;
+    static volatile uint8_t             m_head, m_tail;
+};
+
+template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+spi_transaction_t *spi_bus_t<NO, SCK, MOSI, MISO, DMA, TXCH, RXCH, QSIZE>::m_queue[QSIZE + 1];
+
+template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+spi_transaction_t *volatile spi_bus_t<NO, SCK, MOSI, MISO, DMA, TXCH, RXCH, QSIZE>::m_current = 0;
+
+template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+const spi_device_config_t *spi_bus_t<NO, SCK, MOSI, MISO, DMA, TXCH, RXCH, QSIZE>::m_device = 0;
+
+template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+volatile uint8_t spi_bus_t<NO, SCK, MOSI, MISO, DMA, TXCH, RXCH, QSIZE>::m_head = 0;
+
+template<int NO, gpio_pin_t SCK, gpio_pin_t MOSI, gpio_pin_t MISO, typename DMA, uint8_t TXCH, uint8_t RXCH, uint8_t QSIZE>
+volatile uint8_t spi_bus_t<NO, SCK, MOSI, MISO, DMA, TXCH, RXCH, QSIZE>::m_tail = 0;
+
 }
 
 }
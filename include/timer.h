@@ -2,6 +2,7 @@
 
 #include <hal.h>
 #include <gpio.h>
+#include "dma.h"
 
 namespace hal
 {
@@ -12,17 +13,43 @@ namespace timer
 using namespace device;
 using gpio::internal::alternate_function_t;
 
+#if defined(STM32F0)
+static constexpr uint32_t timer_kernel_clock = 48000000;        // PCLK
+#elif defined(STM32F1)
+static constexpr uint32_t timer_kernel_clock = 72000000;        // PCLK2, PCLK1 x 2
+#elif defined(STM32F4)
+static constexpr uint32_t timer_kernel_clock = 100000000;       // PCLK2, PCLK1 x 2
+#elif defined(STM32F7)
+static constexpr uint32_t timer_kernel_clock = 16000000;        // HSI
+#elif defined(STM32G0)
+static constexpr uint32_t timer_kernel_clock = 64000000;        // PCLK
+#elif defined(STM32G4)
+static constexpr uint32_t timer_kernel_clock = 170000000;       // PCLK1, PCLK2
+#endif
+
 template<int TN> struct timer_traits
 {
     static_assert(always_false_i<TN>::value, "timer not available on this mcu");
 };
 
+// Capture/compare dma request offset for timers with requests on fewer
+// channels than they have (TIM15, TIM16, TIM17).
+
+template<channel_t CH, channel_t LAST>
+static constexpr uint8_t dma_cc_offset()
+{
+    static_assert(CH <= LAST, "no dma request for this timer channel");
+    return CH;
+}
+
 template<channel_t CH, typename T> struct timer_channel_traits
 {
     static_assert(always_false_t<T>::value, "channel number not available on this timer");
 };
 
 template<channel_t CH, typename T> struct timer_altfun_traits {};
+template<channel_t CH, typename T> struct timer_altfun_n_traits {};
+template<typename T> struct timer_break_traits {};
 
 template<typename T> struct timer_channel_traits<CH1, T>
 {
@@ -60,26 +87,186 @@ template<typename T> struct timer_channel_traits<CH4, T>
     static inline volatile uint32_t& CCMR() { return T::TIM().CCMR2; }
 };
 
+template<channel_t CH, typename T> struct timer_channel_n_traits
+{
+    static_assert(always_false_t<T>::value, "no complementary output on this channel");
+};
+
+template<typename T> struct timer_channel_n_traits<CH1, T>
+{
+    static const uint32_t CCER_CCNE = T::_::CCER_CC1NE;
+    static const uint32_t CCER_CCNP = T::_::CCER_CC1NP;
+    static const uint32_t CR2_OIS = T::_::CR2_OIS1;
+    static const uint32_t CR2_OISN = T::_::CR2_OIS1N;
+};
+
+template<typename T> struct timer_channel_n_traits<CH2, T>
+{
+    static const uint32_t CCER_CCNE = T::_::CCER_CC2NE;
+    static const uint32_t CCER_CCNP = T::_::CCER_CC2NP;
+    static const uint32_t CR2_OIS = T::_::CR2_OIS2;
+    static const uint32_t CR2_OISN = T::_::CR2_OIS2N;
+};
+
+template<typename T> struct timer_channel_n_traits<CH3, T>
+{
+    static const uint32_t CCER_CCNE = T::_::CCER_CC3NE;
+    static const uint32_t CCER_CCNP = T::_::CCER_CC3NP;
+    static const uint32_t CR2_OIS = T::_::CR2_OIS3;
+    static const uint32_t CR2_OISN = T::_::CR2_OIS3N;
+};
+
+template<channel_t CH, typename T> struct timer_capture_traits
+{
+    static_assert(always_false_t<T>::value, "channel number not available on this timer");
+};
+
+template<typename T> struct timer_capture_traits<CH1, T>
+{
+    template<uint32_t X> static const uint32_t CCMR_CCS = T::_::template CCMR1_CC1S<X>;
+    template<uint32_t X> static const uint32_t CCMR_ICF = T::_::template CCMR1_IC1F<X>;
+    template<uint32_t X> static const uint32_t CCMR_ICPSC = CCMR_CCS<X> << 2;   // prescaler field name varies by device
+    static const uint32_t CCER_CCP = T::_::CCER_CC1P;
+    static const uint32_t CCER_CCNP = T::_::CCER_CC1P << 2;                 // not present on STM32F1
+    static const uint32_t DIER_CCDE = T::_::DIER_CC1DE;
+};
+
+template<typename T> struct timer_capture_traits<CH2, T>
+{
+    template<uint32_t X> static const uint32_t CCMR_CCS = T::_::template CCMR1_CC2S<X>;
+    template<uint32_t X> static const uint32_t CCMR_ICF = T::_::template CCMR1_IC2F<X>;
+    template<uint32_t X> static const uint32_t CCMR_ICPSC = CCMR_CCS<X> << 2;   // prescaler field name varies by device
+    static const uint32_t CCER_CCP = T::_::CCER_CC2P;
+    static const uint32_t CCER_CCNP = T::_::CCER_CC2P << 2;                 // not present on STM32F1
+    static const uint32_t DIER_CCDE = T::_::DIER_CC2DE;
+};
+
+template<typename T> struct timer_capture_traits<CH3, T>
+{
+    template<uint32_t X> static const uint32_t CCMR_CCS = T::_::template CCMR2_CC3S<X>;
+    template<uint32_t X> static const uint32_t CCMR_ICF = T::_::template CCMR2_IC3F<X>;
+    template<uint32_t X> static const uint32_t CCMR_ICPSC = CCMR_CCS<X> << 2;   // prescaler field name varies by device
+    static const uint32_t CCER_CCP = T::_::CCER_CC3P;
+    static const uint32_t CCER_CCNP = T::_::CCER_CC3P << 2;                 // not present on STM32F1
+    static const uint32_t DIER_CCDE = T::_::DIER_CC3DE;
+};
+
+template<typename T> struct timer_capture_traits<CH4, T>
+{
+    template<uint32_t X> static const uint32_t CCMR_CCS = T::_::template CCMR2_CC4S<X>;
+    template<uint32_t X> static const uint32_t CCMR_ICF = T::_::template CCMR2_IC4F<X>;
+    template<uint32_t X> static const uint32_t CCMR_ICPSC = CCMR_CCS<X> << 2;   // prescaler field name varies by device
+    static const uint32_t CCER_CCP = T::_::CCER_CC4P;
+    static const uint32_t CCER_CCNP = T::_::CCER_CC4P << 2;                 // not present on STM32F1
+    static const uint32_t DIER_CCDE = T::_::DIER_CC4DE;
+};
+
+// Dead-time generator value for NS nanoseconds at the timer kernel clock
+// (CKD = 0). The four DTG ranges trade resolution for length, we round up
+// to the next representable step so the gap is never shorter than asked.
+
+template<uint32_t CLOCK, uint32_t NS>
+struct dead_time_t
+{
+    static constexpr uint32_t ticks = (static_cast<uint64_t>(NS) * CLOCK + 999999999) / 1000000000;
+
+    static_assert(ticks <= 16 * 63, "dead time too long for timer clock");
+
+    static constexpr uint8_t value
+        = ticks <= 127 ? ticks                                  // DTG = 0xxxxxxx, step 1
+        : ticks <= 254 ? 0x80 | ((ticks + 1) / 2 - 64)         // DTG = 10xxxxxx, step 2
+        : ticks <= 504 ? 0xc0 | ((ticks + 7) / 8 - 32)          // DTG = 110xxxxx, step 8
+        : 0xe0 | ((ticks + 15) / 16 - 32)                       // DTG = 111xxxxx, step 16
+        ;
+};
+
+// Prescaler and auto-reload pair whose product is closest to a target number
+// of timer clock ticks. Smaller prescalers are tried first and kept on ties
+// so the counter gets the finest resolution available.
+
+struct timer_setting_t
+{
+    uint16_t    psc;
+    uint32_t    arr;
+    double      ppm;                                            // relative error in parts per million
+};
+
+static constexpr timer_setting_t timer_solve(double ticks, uint32_t max_count)
+{
+    timer_setting_t best = { 0, 0, 1e12 };
+
+    for (uint32_t p = 1; p <= 65536; ++p)
+    {
+        double a = ticks / p + 0.5;
+
+        if (a < 2.)                                             // ARR must be at least one
+            break;
+        if (a > max_count + 1.)
+            continue;
+
+        uint32_t n = static_cast<uint32_t>(a);
+        double err = (static_cast<double>(p) * n - ticks) / ticks * 1e6;
+
+        if (err < 0)
+            err = -err;
+        if (err < best.ppm)
+        {
+            best = { static_cast<uint16_t>(p - 1), n - 1, err };
+            if (err == 0.)
+                break;
+        }
+    }
+    return best;
+}
+
 #if defined(HAVE_PERIPHERAL_TIM1)
 template<> struct timer_traits<1>
 {
     typedef tim1_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM1; }
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_up_request = dma::TIM1_UP;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = dma::TIM1_CH1 + CH;
+#elif defined(STM32F4) || defined(STM32F7)
+    static const uint8_t dma_up_request = 6;                // stream channel selection (DMA2 stream 5)
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 6;
+#else
+    static const uint8_t dma_up_request = 0;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 0;
+#endif
 };
 
 template<> struct timer_altfun_traits<CH1, tim1_t> { static const alternate_function_t altfun = gpio::internal::TIM1_CH1; };
 template<> struct timer_altfun_traits<CH2, tim1_t> { static const alternate_function_t altfun = gpio::internal::TIM1_CH2; };
 template<> struct timer_altfun_traits<CH3, tim1_t> { static const alternate_function_t altfun = gpio::internal::TIM1_CH3; };
 template<> struct timer_altfun_traits<CH4, tim1_t> { static const alternate_function_t altfun = gpio::internal::TIM1_CH4; };
+template<> struct timer_altfun_n_traits<CH1, tim1_t> { static const alternate_function_t altfun = gpio::internal::TIM1_CH1N; };
+template<> struct timer_altfun_n_traits<CH2, tim1_t> { static const alternate_function_t altfun = gpio::internal::TIM1_CH2N; };
+template<> struct timer_altfun_n_traits<CH3, tim1_t> { static const alternate_function_t altfun = gpio::internal::TIM1_CH3N; };
+template<> struct timer_break_traits<tim1_t> { static const alternate_function_t bkin = gpio::internal::TIM1_BKIN; };
 #endif
 
 #if defined(HAVE_PERIPHERAL_TIM2)
 template<> struct timer_traits<2>
 {
     typedef tim2_t T;
+#if defined(STM32F1)
+    typedef uint16_t count_t;
+#else
     typedef uint32_t count_t;
+#endif
     static inline T& TIM() { return TIM2; }
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_up_request = dma::TIM2_UP;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = dma::TIM2_CH1 + CH;
+#elif defined(STM32F4) || defined(STM32F7)
+    static const uint8_t dma_up_request = 3;                // stream channel selection (DMA1 stream 1 or 7)
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 3;
+#else
+    static const uint8_t dma_up_request = 0;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 0;
+#endif
 };
 
 template<> struct timer_altfun_traits<CH1, tim2_t> { static const alternate_function_t altfun = gpio::internal::TIM2_CH1; };
@@ -94,6 +281,16 @@ template<> struct timer_traits<3>
     typedef tim3_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM3; }
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_up_request = dma::TIM3_UP;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = dma::TIM3_CH1 + CH;
+#elif defined(STM32F4) || defined(STM32F7)
+    static const uint8_t dma_up_request = 5;                // stream channel selection (DMA1 stream 2)
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 5;
+#else
+    static const uint8_t dma_up_request = 0;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 0;
+#endif
 };
 
 template<> struct timer_altfun_traits<CH1, tim3_t> { static const alternate_function_t altfun = gpio::internal::TIM3_CH1; };
@@ -108,6 +305,16 @@ template<> struct timer_traits<4>
     typedef tim4_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM4; }
+#if defined(STM32G4)
+    static const uint8_t dma_up_request = dma::TIM4_UP;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = dma::TIM4_CH1 + CH;
+#elif defined(STM32F4) || defined(STM32F7)
+    static const uint8_t dma_up_request = 2;                // stream channel selection (DMA1 stream 6)
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 2;
+#else
+    static const uint8_t dma_up_request = 0;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 0;
+#endif
 };
 
 template<> struct timer_altfun_traits<CH1, tim4_t> { static const alternate_function_t altfun = gpio::internal::TIM4_CH1; };
@@ -120,8 +327,22 @@ template<> struct timer_altfun_traits<CH4, tim4_t> { static const alternate_func
 template<> struct timer_traits<5>
 {
     typedef tim5_t T;
+#if defined(STM32F1)
     typedef uint16_t count_t;
+#else
+    typedef uint32_t count_t;
+#endif
     static inline T& TIM() { return TIM5; }
+#if defined(STM32G4)
+    static const uint8_t dma_up_request = dma::TIM5_UP;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = dma::TIM5_CH1 + CH;
+#elif defined(STM32F4) || defined(STM32F7)
+    static const uint8_t dma_up_request = 6;                // stream channel selection (DMA1 stream 0 or 6)
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 6;
+#else
+    static const uint8_t dma_up_request = 0;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 0;
+#endif
 };
 #endif
 
@@ -131,6 +352,13 @@ template<> struct timer_traits<6>
     typedef tim6_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM6; }
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_up_request = dma::TIM6_UP;
+#elif defined(STM32F4) || defined(STM32F7)
+    static const uint8_t dma_up_request = 7;                // stream channel selection (DMA1 stream 1)
+#else
+    static const uint8_t dma_up_request = 0;
+#endif
 };
 #endif
 
@@ -140,15 +368,53 @@ template<> struct timer_traits<7>
     typedef tim7_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM7; }
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_up_request = dma::TIM7_UP;
+#elif defined(STM32F4) || defined(STM32F7)
+    static const uint8_t dma_up_request = 1;                // stream channel selection (DMA1 stream 2 or 4)
+#else
+    static const uint8_t dma_up_request = 0;
+#endif
 };
 #endif
 
+#if defined(HAVE_PERIPHERAL_TIM8)
+template<> struct timer_traits<8>
+{
+    typedef tim8_t T;
+    typedef uint16_t count_t;
+    static inline T& TIM() { return TIM8; }
+#if defined(STM32G4)
+    static const uint8_t dma_up_request = dma::TIM8_UP;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = dma::TIM8_CH1 + CH;
+#elif defined(STM32F4) || defined(STM32F7)
+    static const uint8_t dma_up_request = 7;                // stream channel selection (DMA2 stream 1)
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 7;
+#else
+    static const uint8_t dma_up_request = 0;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 0;
+#endif
+};
+
+#if defined(STM32F7) || defined(STM32G4)
+template<> struct timer_altfun_traits<CH1, tim8_t> { static const alternate_function_t altfun = gpio::internal::TIM8_CH1; };
+template<> struct timer_altfun_traits<CH2, tim8_t> { static const alternate_function_t altfun = gpio::internal::TIM8_CH2; };
+template<> struct timer_altfun_traits<CH3, tim8_t> { static const alternate_function_t altfun = gpio::internal::TIM8_CH3; };
+template<> struct timer_altfun_traits<CH4, tim8_t> { static const alternate_function_t altfun = gpio::internal::TIM8_CH4; };
+template<> struct timer_altfun_n_traits<CH1, tim8_t> { static const alternate_function_t altfun = gpio::internal::TIM8_CH1N; };
+template<> struct timer_altfun_n_traits<CH2, tim8_t> { static const alternate_function_t altfun = gpio::internal::TIM8_CH2N; };
+template<> struct timer_altfun_n_traits<CH3, tim8_t> { static const alternate_function_t altfun = gpio::internal::TIM8_CH3N; };
+template<> struct timer_break_traits<tim8_t> { static const alternate_function_t bkin = gpio::internal::TIM8_BKIN; };
+#endif
+#endif
+
 #if defined(HAVE_PERIPHERAL_TIM9)
 template<> struct timer_traits<9>
 {
     typedef tim9_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM9; }
+    static const uint8_t dma_up_request = 0;                // no update dma request
 };
 #endif
 
@@ -158,6 +424,7 @@ template<> struct timer_traits<10>
     typedef tim10_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM10; }
+    static const uint8_t dma_up_request = 0;                // no update dma request
 };
 #endif
 
@@ -167,6 +434,7 @@ template<> struct timer_traits<11>
     typedef tim11_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM11; }
+    static const uint8_t dma_up_request = 0;                // no update dma request
 };
 #endif
 
@@ -176,6 +444,7 @@ template<> struct timer_traits<14>
     typedef tim14_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM14; }
+    static const uint8_t dma_up_request = 0;                // no update dma request
 };
 #endif
 
@@ -185,6 +454,16 @@ template<> struct timer_traits<15>
     typedef tim15_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM15; }
+#if defined(STM32G0)
+    static const uint8_t dma_up_request = dma::TIM15_UP;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = dma::TIM15_CH1 + dma_cc_offset<CH, CH2>();
+#elif defined(STM32G4)
+    static const uint8_t dma_up_request = dma::TIM15_UP;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = dma::TIM15_CH1 + dma_cc_offset<CH, CH1>();
+#else
+    static const uint8_t dma_up_request = 0;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 0;
+#endif
 };
 #endif
 
@@ -194,6 +473,13 @@ template<> struct timer_traits<16>
     typedef tim16_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM16; }
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_up_request = dma::TIM16_UP;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = dma::TIM16_CH1 + dma_cc_offset<CH, CH1>();
+#else
+    static const uint8_t dma_up_request = 0;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 0;
+#endif
 };
 #endif
 
@@ -203,7 +489,97 @@ template<> struct timer_traits<17>
     typedef tim17_t T;
     typedef uint16_t count_t;
     static inline T& TIM() { return TIM17; }
+#if defined(STM32G0) || defined(STM32G4)
+    static const uint8_t dma_up_request = dma::TIM17_UP;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = dma::TIM17_CH1 + dma_cc_offset<CH, CH1>();
+#else
+    static const uint8_t dma_up_request = 0;
+    template<channel_t CH> static constexpr uint8_t dma_cc_request = 0;
+#endif
+};
+#endif
+
+// Internal trigger routing: the TS value selecting MASTER's TRGO as trigger
+// input of SLAVE.
+
+#if defined(STM32G4)
+template<int TN> struct timer_itr_index
+{
+    static_assert(always_false_i<TN>::value, "timer is not an internal trigger source");
+};
+
+template<> struct timer_itr_index<1> { static const uint8_t itr = 0; };
+template<> struct timer_itr_index<2> { static const uint8_t itr = 1; };
+template<> struct timer_itr_index<3> { static const uint8_t itr = 2; };
+template<> struct timer_itr_index<4> { static const uint8_t itr = 3; };
+template<> struct timer_itr_index<5> { static const uint8_t itr = 4; };
+template<> struct timer_itr_index<8> { static const uint8_t itr = 5; };
+template<> struct timer_itr_index<15> { static const uint8_t itr = 6; };
+template<> struct timer_itr_index<16> { static const uint8_t itr = 7; };
+template<> struct timer_itr_index<17> { static const uint8_t itr = 8; };
+template<> struct timer_itr_index<20> { static const uint8_t itr = 9; };
+
+template<int SLAVE, int MASTER> struct timer_itr_traits         // same table for all slave timers
+{
+    static_assert(SLAVE != MASTER, "timer cannot trigger itself");
+    static const uint8_t itr = timer_itr_index<MASTER>::itr;
+    static const uint8_t ts = itr < 4 ? itr : itr + 4;          // ITR4 and up from TS = 01000
+};
+#else
+template<int SLAVE, int MASTER> struct timer_itr_traits
+{
+    static_assert(always_false_i<SLAVE>::value, "no internal trigger from master to slave timer");
 };
+
+#if defined(STM32F1) || defined(STM32F4) || defined(STM32F7)
+template<> struct timer_itr_traits<1, 5> { static const uint8_t ts = 0; };
+template<> struct timer_itr_traits<1, 2> { static const uint8_t ts = 1; };
+template<> struct timer_itr_traits<1, 3> { static const uint8_t ts = 2; };
+template<> struct timer_itr_traits<1, 4> { static const uint8_t ts = 3; };
+template<> struct timer_itr_traits<2, 1> { static const uint8_t ts = 0; };
+template<> struct timer_itr_traits<2, 8> { static const uint8_t ts = 1; };
+template<> struct timer_itr_traits<2, 3> { static const uint8_t ts = 2; };
+template<> struct timer_itr_traits<2, 4> { static const uint8_t ts = 3; };
+template<> struct timer_itr_traits<3, 1> { static const uint8_t ts = 0; };
+template<> struct timer_itr_traits<3, 2> { static const uint8_t ts = 1; };
+template<> struct timer_itr_traits<3, 5> { static const uint8_t ts = 2; };
+template<> struct timer_itr_traits<3, 4> { static const uint8_t ts = 3; };
+template<> struct timer_itr_traits<4, 1> { static const uint8_t ts = 0; };
+template<> struct timer_itr_traits<4, 2> { static const uint8_t ts = 1; };
+template<> struct timer_itr_traits<4, 3> { static const uint8_t ts = 2; };
+template<> struct timer_itr_traits<4, 8> { static const uint8_t ts = 3; };
+template<> struct timer_itr_traits<5, 2> { static const uint8_t ts = 0; };
+template<> struct timer_itr_traits<5, 3> { static const uint8_t ts = 1; };
+template<> struct timer_itr_traits<5, 4> { static const uint8_t ts = 2; };
+template<> struct timer_itr_traits<5, 8> { static const uint8_t ts = 3; };
+template<> struct timer_itr_traits<8, 1> { static const uint8_t ts = 0; };
+template<> struct timer_itr_traits<8, 2> { static const uint8_t ts = 1; };
+template<> struct timer_itr_traits<8, 4> { static const uint8_t ts = 2; };
+template<> struct timer_itr_traits<8, 5> { static const uint8_t ts = 3; };
+#if defined(STM32F4) || defined(STM32F7)
+template<> struct timer_itr_traits<9, 2> { static const uint8_t ts = 0; };
+template<> struct timer_itr_traits<9, 3> { static const uint8_t ts = 1; };
+template<> struct timer_itr_traits<9, 10> { static const uint8_t ts = 2; };
+template<> struct timer_itr_traits<9, 11> { static const uint8_t ts = 3; };
+#endif
+#elif defined(STM32F0) || defined(STM32G0)
+template<> struct timer_itr_traits<1, 15> { static const uint8_t ts = 0; };
+template<> struct timer_itr_traits<1, 2> { static const uint8_t ts = 1; };
+template<> struct timer_itr_traits<1, 3> { static const uint8_t ts = 2; };
+template<> struct timer_itr_traits<1, 17> { static const uint8_t ts = 3; };
+template<> struct timer_itr_traits<2, 1> { static const uint8_t ts = 0; };
+template<> struct timer_itr_traits<2, 15> { static const uint8_t ts = 1; };
+template<> struct timer_itr_traits<2, 3> { static const uint8_t ts = 2; };
+template<> struct timer_itr_traits<2, 14> { static const uint8_t ts = 3; };
+template<> struct timer_itr_traits<3, 1> { static const uint8_t ts = 0; };
+template<> struct timer_itr_traits<3, 2> { static const uint8_t ts = 1; };
+template<> struct timer_itr_traits<3, 15> { static const uint8_t ts = 2; };
+template<> struct timer_itr_traits<3, 14> { static const uint8_t ts = 3; };
+template<> struct timer_itr_traits<15, 2> { static const uint8_t ts = 0; };
+template<> struct timer_itr_traits<15, 3> { static const uint8_t ts = 1; };
+template<> struct timer_itr_traits<15, 16> { static const uint8_t ts = 2; };
+template<> struct timer_itr_traits<15, 17> { static const uint8_t ts = 3; };
+#endif
 #endif
 
 template<typename, channel_t, gpio::gpio_pin_t> class pwm_t;
@@ -214,7 +590,14 @@ class timer_t
 public:
     static const int TNO = TN;
     typedef typename timer_traits<TN>::count_t count_t;
-    enum master_mode_t { mm_reset, mm_enable, mm_update };
+    enum master_mode_t { mm_reset, mm_enable, mm_update, mm_compare_pulse, mm_oc1ref, mm_oc2ref, mm_oc3ref, mm_oc4ref };
+    enum slave_mode_t { sm_disabled, sm_encoder1, sm_encoder2, sm_encoder3, sm_reset, sm_gated, sm_trigger, sm_external_clock };
+    enum counter_mode_t { edge_aligned, center_aligned_down, center_aligned_up, center_aligned_both };
+    enum trigger_source_t { ts_itr0, ts_itr1, ts_itr2, ts_itr3, ts_ti1f_ed, ts_ti1fp1, ts_ti2fp2, ts_etrf, ts_none = 0xff };
+    enum dma_burst_base_t                       // DCR base address in words from CR1
+        { dba_cr1, dba_cr2, dba_smcr, dba_dier, dba_sr, dba_egr, dba_ccmr1, dba_ccmr2, dba_ccer
+        , dba_cnt, dba_psc, dba_arr, dba_rcr, dba_ccr1, dba_ccr2, dba_ccr3, dba_ccr4, dba_bdtr
+        };
 
     static inline void setup(uint16_t psc, count_t arr)
     {
@@ -226,11 +609,62 @@ public:
         TIM().CR1 |= _::CR1_CEN;        // FIXME: should this be on by default?
     }
 
+    // Choose PSC and ARR at compile time for an update rate of HZ (or a period
+    // of NS nanoseconds) from the timer kernel clock, failing to compile when
+    // the best setting is off by more than TOL_PPM.
+
+    template<uint32_t HZ>
+    static constexpr timer_setting_t frequency_setting()
+    {
+        return timer_solve(static_cast<double>(timer_kernel_clock) / HZ, static_cast<count_t>(~0));
+    }
+
+    template<uint64_t NS>
+    static constexpr timer_setting_t period_setting()
+    {
+        return timer_solve(static_cast<double>(timer_kernel_clock) * NS / 1e9, static_cast<count_t>(~0));
+    }
+
+    template<uint32_t HZ>
+    static constexpr double achieved_frequency()
+    {
+        return static_cast<double>(timer_kernel_clock) / ((frequency_setting<HZ>().psc + 1.) * (frequency_setting<HZ>().arr + 1.));
+    }
+
+    template<uint64_t NS>
+    static constexpr double achieved_period_ns()
+    {
+        return (period_setting<NS>().psc + 1.) * (period_setting<NS>().arr + 1.) * 1e9 / timer_kernel_clock;
+    }
+
+    template<uint32_t HZ, uint32_t TOL_PPM = 100>
+    static inline void setup_frequency()
+    {
+        constexpr timer_setting_t s = frequency_setting<HZ>();
+
+        static_assert(s.ppm <= TOL_PPM, "timer frequency not achievable within tolerance");
+        setup(s.psc, s.arr);
+    }
+
+    template<uint64_t NS, uint32_t TOL_PPM = 100>
+    static inline void setup_period()
+    {
+        constexpr timer_setting_t s = period_setting<NS>();
+
+        static_assert(s.ppm <= TOL_PPM, "timer period not achievable within tolerance");
+        setup(s.psc, s.arr);
+    }
+
     static inline void enable()
     {
         TIM().CR1 |= _::CR1_CEN;
     }
 
+    static inline void wait_enabled()                           // e.g. after a slave trigger
+    {
+        while (!(TIM().CR1 & _::CR1_CEN));
+    }
+
     static inline void disable()
     {
         TIM().CR1 &= ~_::CR1_CEN;
@@ -244,7 +678,22 @@ public:
     template<master_mode_t MM>
     static inline void master_mode()
     {
-        TIM().CR2 |= _::template CR2_MMS<MM>;
+        TIM().CR2 = (TIM().CR2 & ~_::template CR2_MMS<0x7>) | _::template CR2_MMS<MM>;
+    }
+
+    template<slave_mode_t SM, uint8_t TS>
+    static inline void slave_mode()
+    {
+        TIM().SMCR = (TIM().SMCR & ~(_::template SMCR_SMS<0x7> | trigger_select<0x1f>()))
+                   | _::template SMCR_SMS<SM>
+                   | trigger_select<TS>()
+                   ;
+    }
+
+    template<int MASTER, slave_mode_t SM>
+    static inline void slave_of()                               // trigger input from MASTER's TRGO
+    {
+        slave_mode<SM, timer_itr_traits<TN, MASTER>::ts>();
     }
 
     static inline volatile bool uif()
@@ -254,7 +703,7 @@ public:
 
     static inline void clear_uif()
     {
-        TIM().SR &= ~_::SR_UIF;
+        TIM().SR = ~_::SR_UIF;                  // rc_w0, other flags unaffected
     }
 
     static inline volatile count_t count()
@@ -272,17 +721,299 @@ public:
         TIM().BDTR |= _::BDTR_MOE;
     }
 
+    static inline void main_output_disable()
+    {
+        TIM().BDTR &= ~_::BDTR_MOE;
+    }
+
+    template<counter_mode_t CM>
+    static inline void counter_mode()                           // only while counter is disabled
+    {
+        TIM().CR1 = (TIM().CR1 & ~_::template CR1_CMS<0x3>) | _::template CR1_CMS<CM>;
+    }
+
+    static inline void repetition_count(uint8_t n)              // update event every n + 1 periods
+    {
+        TIM().RCR = n;
+    }
+
+    template<uint32_t NS>
+    static inline void dead_time()
+    {
+        TIM().BDTR = (TIM().BDTR & ~_::template BDTR_DTG<0xff>)
+                   | _::template BDTR_DTG<dead_time_t<timer_kernel_clock, NS>::value>
+                   ;
+    }
+
+    // Break input forces all outputs to their idle state in hardware by clearing
+    // MOE. Outputs stay off until main_output_enable() is called again.
+
+    template<gpio::gpio_pin_t PIN, bool ACTIVE_HIGH = false, uint8_t FILTER = 0>
+    static inline void break_input()
+    {
+        gpio::internal::alternate_t<PIN, timer_break_traits<_>::bkin>::template setup<ACTIVE_HIGH ? gpio::pull_down : gpio::pull_up>();
+
+        TIM().BDTR |= _::BDTR_OSSR                              // drive idle level when disabled in run mode
+                   |  _::BDTR_OSSI                              // drive idle level when MOE is cleared
+                   |  (ACTIVE_HIGH ? _::BDTR_BKP : 0)            // break polarity
+#if defined(STM32F7) || defined(STM32G0) || defined(STM32G4)
+                   |  _::template BDTR_BKF<FILTER>              // break input filter
+#endif
+                   |  _::BDTR_BKE                               // enable break input
+                   ;
+    }
+
+    static inline void break_interrupt_enable()
+    {
+        TIM().DIER |= _::DIER_BIE;
+    }
+
+    static inline bool break_flag()
+    {
+        return (TIM().SR & _::SR_BIF) != 0;
+    }
+
+    static inline void clear_break_flag()
+    {
+        TIM().SR = ~_::SR_BIF;                  // rc_w0, other flags unaffected
+    }
+
+    // Bracket compare register writes on several channels so they are all
+    // transferred from the preload registers on the same update event.
+
+    static inline void begin_update()
+    {
+        TIM().CR1 |= _::CR1_UDIS;
+    }
+
+    static inline void end_update()
+    {
+        TIM().CR1 &= ~_::CR1_UDIS;
+    }
+
+    static inline void generate_update()
+    {
+        TIM().EGR = _::EGR_UG;
+    }
+
     static inline void set_auto_reload_value(count_t arr)
     {
         TIM().ARR = arr;
     }
 
+    // Stream LEN consecutive registers from BASE on every update event. The
+    // buffer holds nelem items, i.e. nelem / LEN tuples, and the timer issues
+    // one dma request per register through DMAR.
+
+    template<typename DMA, uint8_t DMACH, dma_burst_base_t BASE, uint8_t LEN, typename T = count_t, dma::circular_mode CIRC_MODE = dma::circular>
+    static inline void dma_burst(const T *buf, uint16_t nelem)
+    {
+        static_assert(LEN > 0 && BASE + LEN <= dba_bdtr + 1, "dma burst beyond timer register block");
+
+        TIM().DIER &= ~_::DIER_UDE;                             // stop requests while re-arming
+        DMA::template disable<DMACH>();
+        DMA::template clear_interrupt_flags<DMACH>();
+        DMA::template mem_to_periph<DMACH, T, dma::dma_type_size<uint32_t>(), CIRC_MODE>(buf, nelem, &TIM().DMAR);
+        DMA::template request<DMACH, timer_traits<TN>::dma_up_request>();
+        DMA::template enable<DMACH>();
+        TIM().DCR = _::template DCR_DBA<BASE>                   // first register of burst
+                  | _::template DCR_DBL<LEN - 1>                // registers per update event
+                  ;
+        TIM().DIER |= _::DIER_UDE;                              // dma request on update event
+    }
+
+    template<typename DMA, uint8_t DMACH>
+    static inline void dma_burst_disable()
+    {
+        TIM().DIER &= ~_::DIER_UDE;
+        DMA::template disable<DMACH>();
+    }
+
 //private:
+    template<uint8_t TS>
+    static constexpr uint32_t trigger_select()
+    {
+#if defined(STM32G4)
+        return _::template SMCR_TS<TS & 0x7> | _::template SMCR_TS_4_3<(TS >> 3) & 0x3>;
+#else
+        return _::template SMCR_TS<TS & 0x7>;
+#endif
+    }
+
     template<typename, channel_t, gpio::gpio_pin_t> friend class pwm_t;
     static inline typename timer_traits<TN>::T& TIM() { return timer_traits<TN>::TIM(); }
     typedef typename timer_traits<TN>::T _;
 };
 
+// Start timers in phase. MASTER drives TRGO on enable and the others start
+// on it in trigger slave mode, so all counters begin on the same timer clock
+// edge (MSM delays the master by the trigger latency). Timers are expected
+// to be set up and stopped; their counters restart from zero. The master's
+// trigger output and MSM are restored once all slaves run, so a master that
+// also clocks e.g. an adc keeps its TRGO; slaves remain in trigger mode.
+
+template<int MASTER, int... SLAVES>
+static void start_synchronized()
+{
+    typedef timer_t<MASTER> master;
+
+    master::disable();
+    (timer_t<SLAVES>::disable(), ...);
+    (timer_t<SLAVES>::template slave_of<MASTER, timer_t<SLAVES>::sm_trigger>(), ...);
+    (timer_t<SLAVES>::set_count(0), ...);
+    uint32_t cr2 = master::TIM().CR2, smcr = master::TIM().SMCR;
+
+    master::template master_mode<master::mm_enable>();
+    master::TIM().SMCR |= master::_::SMCR_MSM;                 // master/slave delay
+    master::set_count(0);
+    master::enable();
+    (timer_t<SLAVES>::wait_enabled(), ...);                     // started by trigger
+    master::TIM().CR2 = cr2;                                    // previous trigger output
+    master::TIM().SMCR = smcr;
+}
+
+// Two 16-bit timers chained into a 32-bit counter: HI counts the update
+// events of LO in external clock mode from LO's TRGO.
+
+template<int LO, int HI>
+class chain_t
+{
+public:
+    static void setup(uint16_t psc = 0)
+    {
+        lo::setup(psc, 0xffff);
+        lo::disable();
+        lo::template master_mode<lo::mm_update>();
+        hi::setup(0, 0xffff);
+        hi::disable();
+        hi::template slave_of<LO, hi::sm_external_clock>();
+        hi::set_count(0);
+        lo::set_count(0);
+        hi::enable();
+        lo::enable();
+    }
+
+    static uint32_t count()                                     // consistent across a low word wrap
+    {
+        uint16_t h, l;
+
+        do
+        {
+            h = hi::count();
+            l = lo::count();
+        } while (h != static_cast<uint16_t>(hi::count()));
+        return (static_cast<uint32_t>(h) << 16) | l;
+    }
+
+private:
+    typedef timer_t<LO> lo;
+    typedef timer_t<HI> hi;
+};
+
+// Monotonic 64-bit timebase counting at FREQ on a free running timer. The
+// counter provides the low bits and the update interrupt adds one full counter
+// period to the high part, so a 32-bit timer (TIM2, TIM5) overflows rarely
+// while 16-bit timers work at a higher interrupt rate. Call isr() from the
+// timer update handler and enable the timer interrupt in the nvic.
+
+template<int TN, uint32_t FREQ = timer_kernel_clock>
+class timebase_t
+{
+public:
+    typedef typename timer_traits<TN>::count_t count_t;
+    static constexpr uint32_t freq = FREQ;
+
+    static void setup()
+    {
+        static_assert(timer_kernel_clock % FREQ == 0, "timebase frequency must divide timer clock");
+        static_assert(timer_kernel_clock / FREQ <= 65536, "timebase frequency too low for prescaler");
+
+        tim::setup(timer_kernel_clock / FREQ - 1, static_cast<count_t>(~0));
+        tim::generate_update();                                 // load prescaler now
+        tim::set_count(0);
+        tim::clear_uif();
+        s_high = 0;
+        tim::update_interrupt_enable();
+    }
+
+    static inline void isr()
+    {
+        if (tim::uif())
+        {
+            tim::clear_uif();
+            s_high = s_high + period;
+        }
+    }
+
+    // The counter may wrap between reading the high part and the counter, or
+    // while the update interrupt is held off (e.g. from a higher priority
+    // handler). A pending UIF with a small count means the wrap is not yet
+    // accounted for, a changed high part means the handler ran, so retry.
+
+    static uint64_t now()
+    {
+        uint64_t h;
+        count_t c;
+        bool pending;
+
+        do
+        {
+            h = s_high;
+            c = tim::count();
+            pending = tim::uif();
+        } while (h != s_high);
+
+        if (pending && c < period / 2)
+            h += period;
+        return h + c;
+    }
+
+    // Conversions split whole and fractional units so the products stay in
+    // range over the full 64-bit tick count. Ticks are rounded up.
+
+    static constexpr uint64_t from_ns(uint64_t ns) { return from_units<1000000000>(ns); }
+    static constexpr uint64_t from_us(uint64_t us) { return from_units<1000000>(us); }
+    static constexpr uint64_t from_ms(uint64_t ms) { return from_units<1000>(ms); }
+    static constexpr uint64_t to_ns(uint64_t ticks) { return to_units<1000000000>(ticks); }
+    static constexpr uint64_t to_us(uint64_t ticks) { return to_units<1000000>(ticks); }
+    static constexpr uint64_t to_ms(uint64_t ticks) { return to_units<1000>(ticks); }
+
+    static inline bool expired(uint64_t deadline)
+    {
+        return now() >= deadline;
+    }
+
+    static inline void delay_until(uint64_t deadline)
+    {
+        while (!expired(deadline));
+    }
+
+    static inline void delay_ns(uint32_t ns) { delay_until(now() + from_ns(ns)); }
+    static inline void delay_us(uint32_t us) { delay_until(now() + from_us(us)); }
+    static inline void delay_ms(uint32_t ms) { delay_until(now() + from_ms(ms)); }
+
+private:
+    typedef timer_t<TN> tim;
+    static constexpr uint64_t period = static_cast<uint64_t>(static_cast<count_t>(~0)) + 1;
+
+    template<uint64_t UNIT>
+    static constexpr uint64_t from_units(uint64_t x)
+    {
+        return x / UNIT * FREQ + (x % UNIT * FREQ + UNIT - 1) / UNIT;
+    }
+
+    template<uint64_t UNIT>
+    static constexpr uint64_t to_units(uint64_t ticks)
+    {
+        return ticks / FREQ * UNIT + ticks % FREQ * UNIT / FREQ;
+    }
+
+    static volatile uint64_t s_high;
+};
+
+template<int TN, uint32_t FREQ>
+volatile uint64_t timebase_t<TN, FREQ>::s_high;
+
 template<int TN, gpio::gpio_pin_t PIN1, gpio::gpio_pin_t PIN2>
 class encoder_t
 {
@@ -324,7 +1055,136 @@ private:
     static inline typename timer_traits<TN>::T& TIM() { return timer_traits<TN>::TIM(); }
 };
 
-template<int TN, gpio::gpio_pin_t CH1>
+// Encoder velocity by the M/T method. The encoder timer captures its count on
+// each rising edge of TI1 and pulses TRGO (compare pulse), which a free running
+// clock timer TC receives as internal trigger and captures as the edge
+// time. Velocity is the count difference over the time difference between
+// the last edges seen by successive update() calls, so it is exact at speed
+// and, without new edges, decays as the edge spacing bound grows at low speed.
+// Call update() at the control rate; velocity() is a single word read that
+// needs no locking. Encoder and clock counters must run over their full range.
+// The clock timer must be 32-bit so edge spacing can be measured up to half
+// its range (about 12 s at 170 MHz and PSC = 0); an encoder standing still
+// for longer reads zero until two new edges have been seen.
+
+template<int TN, gpio::gpio_pin_t PIN1, gpio::gpio_pin_t PIN2, int TC, uint16_t PSC = 0>
+class encoder_velocity_t
+{
+public:
+    typedef encoder_t<TN, PIN1, PIN2> encoder;
+    typedef typename timer_traits<TN>::count_t count_t;
+    typedef typename timer_traits<TC>::count_t stamp_t;
+    static constexpr float clock = static_cast<float>(timer_kernel_clock) / (PSC + 1);
+
+    template<gpio::input_type_t input_type>
+    static void setup()
+    {
+        static_assert(sizeof(stamp_t) == 4, "clock timer must be 32-bit");
+
+        encoder::template setup<input_type>(static_cast<count_t>(~0));
+        ENC().CR2 = (ENC().CR2 & ~E::template CR2_MMS<0x7>)
+                  | E::template CR2_MMS<0x3>                    // TRGO on capture (compare pulse)
+                  ;
+        ENC().CCER |= E::CCER_CC1E;                             // capture count on TI1 edge
+
+        timer_t<TC>::setup(PSC, static_cast<stamp_t>(~0));
+        TIM().EGR = C::EGR_UG;                                  // load prescaler now
+        TIM().CCMR1 = (TIM().CCMR1 & ~C::template CCMR1_CC1S<0x3>)
+                    | C::template CCMR1_CC1S<0x3>               // IC1 mapped on TRC
+                    ;
+        TIM().SMCR = C::SMCR_RESET_VALUE                        // encoder TRGO as trigger
+                   | timer_t<TC>::template trigger_select<timer_itr_traits<TC, TN>::ts>()
+                   ;
+        TIM().CCER |= C::CCER_CC1E;                             // capture edge time
+
+        s_pos = ENC().CCR1;
+        s_time = TIM().CCR1;
+        s_velocity = 0;
+        s_stalled = false;
+    }
+
+    static void update()
+    {
+        count_t p;
+        stamp_t t;
+
+        do
+        {
+            p = ENC().CCR1;                                     // count and time of last edge
+            t = TIM().CCR1;
+        } while (p != static_cast<count_t>(ENC().CCR1));
+
+        if (p != s_pos)
+        {
+            int64_t m = static_cast<count_t>(p - s_pos);
+
+            if (m > static_cast<count_t>(~0) / 2)                // moved backwards
+                m -= static_cast<int64_t>(static_cast<count_t>(~0)) + 1;
+            stamp_t dt = static_cast<stamp_t>(t - s_time);
+
+            if (dt && !s_stalled)                               // previous edge time is valid
+                s_velocity = m * clock / dt;
+            s_pos = p;
+            s_time = t;
+            s_stalled = false;
+        }
+        else if (!s_stalled)
+        {
+            stamp_t dt = static_cast<stamp_t>(TIM().CNT - s_time);
+
+            if (dt > max_span)                                  // edge time about to wrap
+            {
+                s_velocity = 0;
+                s_stalled = true;
+                return;
+            }
+
+            float bound = dt ? 4 * clock / dt : 0.;             // next edge is at least 4 counts away
+
+            if (s_velocity > bound)
+                s_velocity = bound;
+            else if (s_velocity < -bound)
+                s_velocity = -bound;
+        }
+    }
+
+    static inline float velocity()                              // counts per second
+    {
+        return s_velocity;
+    }
+
+    static inline count_t position()
+    {
+        return encoder::count();
+    }
+
+private:
+    typedef typename timer_traits<TN>::T E;
+    typedef typename timer_traits<TC>::T C;
+    static inline E& ENC() { return timer_traits<TN>::TIM(); }
+    static inline C& TIM() { return timer_traits<TC>::TIM(); }
+
+    static constexpr stamp_t max_span = static_cast<stamp_t>(~0) / 2;
+
+    static count_t          s_pos;
+    static stamp_t          s_time;
+    static volatile float   s_velocity;
+    static bool             s_stalled;                          // s_time too old to use
+};
+
+template<int TN, gpio::gpio_pin_t PIN1, gpio::gpio_pin_t PIN2, int TC, uint16_t PSC>
+typename timer_traits<TN>::count_t encoder_velocity_t<TN, PIN1, PIN2, TC, PSC>::s_pos;
+
+template<int TN, gpio::gpio_pin_t PIN1, gpio::gpio_pin_t PIN2, int TC, uint16_t PSC>
+typename timer_traits<TC>::count_t encoder_velocity_t<TN, PIN1, PIN2, TC, PSC>::s_time;
+
+template<int TN, gpio::gpio_pin_t PIN1, gpio::gpio_pin_t PIN2, int TC, uint16_t PSC>
+volatile float encoder_velocity_t<TN, PIN1, PIN2, TC, PSC>::s_velocity;
+
+template<int TN, gpio::gpio_pin_t PIN1, gpio::gpio_pin_t PIN2, int TC, uint16_t PSC>
+bool encoder_velocity_t<TN, PIN1, PIN2, TC, PSC>::s_stalled;
+
+template<int TN, gpio::gpio_pin_t PIN>
 class capture_t
 {
 public:
@@ -336,7 +1196,7 @@ public:
     {
         using namespace gpio::internal;
 
-        alternate_t<CH1, timer_traits<TN>::ch1>::template setup<input_type>();
+        alternate_t<PIN, timer_altfun_traits<CH1, _>::altfun>::template setup<input_type>();
 
         peripheral_traits<_>::enable();
         TIM().CCMR1 = _::CCMR1_RESET_VALUE          // reset register
@@ -367,6 +1227,138 @@ private:
     static inline typename timer_traits<TN>::T& TIM() { return timer_traits<TN>::TIM(); }
 };
 
+// Input capture with the compare register streamed into a circular buffer
+// by dma, one timestamp per captured edge and no interrupts. The timer must
+// be free running (see timer_t::setup), intervals are taken modulo ARR + 1
+// so each must be shorter than one counter period.
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, typename DMA, uint8_t DMACH, uint16_t SIZE>
+class capture_dma_t
+{
+public:
+    typedef typename TIMER::count_t count_t;
+
+    template<gpio::trigger_edge_t EDGE = gpio::rising_edge, uint8_t FILTER = 0, uint8_t PRESCALE = 0, gpio::input_type_t input_type = gpio::floating>
+    static void setup()
+    {
+#if defined(STM32F1)
+        static_assert(EDGE != gpio::both_edges, "both edge capture not supported on this mcu");
+#endif
+        static_assert(FILTER < 16, "input filter out of range");
+        static_assert(PRESCALE < 4, "input prescaler out of range");    // capture every 1, 2, 4 or 8 edges
+        static_assert(PRESCALE == 0 || EDGE != gpio::both_edges, "prescaled both edge capture breaks edge pairing");
+        static_assert(SIZE > 2, "capture buffer too small");
+
+        pin::template setup<input_type>();
+        TIMER::TIM().CCER &= ~(__::CCER_CCE | ___::CCER_CCP | ___::CCER_CCNP);
+        __::CCMR() = (__::CCMR() & ~(___::template CCMR_CCS<0x3> | ___::template CCMR_ICPSC<0x3> | ___::template CCMR_ICF<0xf>))
+                   | ___::template CCMR_CCS<0x1>                // ICx mapped on TIx
+                   | ___::template CCMR_ICPSC<PRESCALE>         // input prescaler
+                   | ___::template CCMR_ICF<FILTER>             // input filter
+                   ;
+        s_both = EDGE == gpio::both_edges;
+
+        DMA::template disable<DMACH>();
+        DMA::template clear_interrupt_flags<DMACH>();
+        DMA::template periph_to_mem<DMACH>(&__::CCR(), s_buf, SIZE);
+        DMA::template request<DMACH, timer_traits<TIMER::TNO>::template dma_cc_request<CH> >();
+        DMA::template enable<DMACH>();
+
+        TIMER::TIM().CCER |= (EDGE == gpio::falling_edge ? ___::CCER_CCP : 0)
+                          |  (EDGE == gpio::both_edges ? ___::CCER_CCP | ___::CCER_CCNP : 0)
+                          |  __::CCER_CCE                       // enable capture
+                          ;
+        TIMER::TIM().DIER |= ___::DIER_CCDE;                    // dma request on capture
+    }
+
+    static void disable()
+    {
+        TIMER::TIM().DIER &= ~___::DIER_CCDE;
+        TIMER::TIM().CCER &= ~__::CCER_CCE;
+        DMA::template disable<DMACH>();
+    }
+
+    static uint16_t head()                                      // index of next timestamp
+    {
+        return SIZE - DMA::template remaining<DMACH>();
+    }
+
+    static count_t timestamp(uint16_t age = 0)                  // age = 0 is latest capture
+    {
+        return s_buf[(head() + 2 * SIZE - 1 - age) % SIZE];
+    }
+
+    static uint32_t interval(uint16_t age = 0)                  // ticks between two consecutive captures
+    {
+        uint16_t h = head();
+
+        return delta(s_buf[(h + 2 * SIZE - 2 - age) % SIZE], s_buf[(h + 2 * SIZE - 1 - age) % SIZE]);
+    }
+
+    static uint32_t period(uint16_t window = 1)                 // mean signal period in ticks
+    {
+        uint16_t h = head(), n = s_both ? 2 * window : window;
+        uint32_t sum = 0;
+
+        for (uint16_t i = 0; i < n && i + 2 <= SIZE; ++i)
+            sum += delta(s_buf[(h + 2 * SIZE - 2 - i) % SIZE], s_buf[(h + 2 * SIZE - 1 - i) % SIZE]);
+        return sum / window;
+    }
+
+    static float frequency(uint16_t window = 1)                 // mean signal frequency in Hz
+    {
+        uint32_t p = period(window);
+
+        return p ? static_cast<float>(timer_kernel_clock) / ((TIMER::TIM().PSC + 1) * static_cast<float>(p)) : 0.;
+    }
+
+    // Duty needs both edge capture. The level of the pin tells which edge was
+    // captured last, we retry if another edge lands while we look.
+
+    static float duty(uint16_t window = 1)
+    {
+        uint16_t h;
+        bool high;
+
+        do
+        {
+            h = head();
+            high = (gpio::pin_t<PIN>::gpio().IDR & gpio::pin_t<PIN>::bit_mask) != 0;
+        } while (h != head());
+
+        uint32_t on = 0, total = 0;
+
+        for (uint16_t i = 0; i < 2 * window && i + 2 <= SIZE; ++i)
+        {
+            uint32_t d = delta(s_buf[(h + 2 * SIZE - 2 - i) % SIZE], s_buf[(h + 2 * SIZE - 1 - i) % SIZE]);
+
+            if ((i & 1) == high)                                // interval ending in a falling edge
+                on += d;
+            total += d;
+        }
+        return total ? static_cast<float>(on) / total : 0.;
+    }
+
+private:
+    typedef timer_channel_traits<CH, TIMER> __;
+    typedef timer_capture_traits<CH, TIMER> ___;
+    typedef gpio::internal::alternate_t<PIN, timer_altfun_traits<CH, typename TIMER::_>::altfun> pin;
+
+    static uint32_t delta(count_t a, count_t b)
+    {
+        return b >= a ? b - a : b + TIMER::TIM().ARR + 1 - a;
+    }
+
+    static volatile count_t s_buf[SIZE];
+    static bool s_both;
+};
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, typename DMA, uint8_t DMACH, uint16_t SIZE>
+volatile typename TIMER::count_t capture_dma_t<TIMER, CH, PIN, DMA, DMACH, SIZE>::s_buf[SIZE];
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, typename DMA, uint8_t DMACH, uint16_t SIZE>
+bool capture_dma_t<TIMER, CH, PIN, DMA, DMACH, SIZE>::s_both;
+
 template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN>
 class pwm_t
 {
@@ -399,6 +1391,332 @@ public:
     }
 };
 
+// Complementary pwm on an advanced-control timer channel. The CHx and CHxN
+// outputs are driven from the same compare value with dead time inserted on
+// both edges by the timer. Configure dead time, counter mode and break input
+// on the timer before calling main_output_enable().
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, gpio::gpio_pin_t NPIN>
+class complementary_pwm_t
+{
+private:
+    typedef typename TIMER::_ _;
+    typedef timer_channel_traits<CH, TIMER> __;
+    typedef timer_channel_n_traits<CH, TIMER> ___;
+    typedef gpio::internal::alternate_t<PIN, timer_altfun_traits<CH, _>::altfun> pin;
+    typedef gpio::internal::alternate_t<NPIN, timer_altfun_n_traits<CH, _>::altfun> npin;
+
+public:
+    template<bool IDLE_HIGH = false, bool IDLE_HIGH_N = false>
+    static void setup(typename TIMER::count_t initial_duty = 0)
+    {
+        pin::template setup<gpio::high_speed>();                // initialize high side pin
+        npin::template setup<gpio::high_speed>();               // initialize low side pin
+        TIMER::TIM().CR2 = (TIMER::TIM().CR2 & ~(___::CR2_OIS | ___::CR2_OISN))
+                         | (IDLE_HIGH ? ___::CR2_OIS : 0)       // high side level on break
+                         | (IDLE_HIGH_N ? ___::CR2_OISN : 0)    // low side level on break
+                         ;
+        __::CCMR() |= __::template CCMR_OCM<0x6>                // pwm mode 1
+                   |  __::CCMR_OCPE                             // channel preload enable
+                   ;
+        __::CCR() = initial_duty;                               // set initial duty cycle
+        TIMER::TIM().CR1 |= _::CR1_ARPE;                        // auto-reload preload enable
+        TIMER::TIM().CCER |= __::CCER_CCE | ___::CCER_CCNE;     // enable both outputs
+    }
+
+    static typename TIMER::count_t duty()
+    {
+        return __::CCR();
+    }
+
+    static void duty(typename TIMER::count_t x)
+    {
+        __::CCR() = x;
+    }
+};
+
+// Hardware pulse generator in one-pulse mode. The output goes active DELAY_NS
+// after the trigger and inactive WIDTH_NS later (pwm mode 2 with CCR = delay,
+// ARR = delay + width - 1), then the counter stops by itself. Triggers come
+// from software, a TIx input (see trigger_input) or another timer (ITRx). On
+// G0/G4 the retriggerable variant restarts the pulse on every trigger. Call
+// main_output_enable() on advanced-control timers.
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN>
+class one_pulse_t
+{
+private:
+    typedef typename TIMER::_ _;
+    typedef timer_channel_traits<CH, TIMER> __;
+    typedef gpio::internal::alternate_t<PIN, timer_altfun_traits<CH, _>::altfun> pin;
+
+    static constexpr uint32_t ticks(uint32_t ns, uint16_t psc)
+    {
+        return (static_cast<uint64_t>(ns) * (timer_kernel_clock / (psc + 1)) + 500000000) / 1000000000;
+    }
+
+public:
+    template< uint32_t DELAY_NS, uint32_t WIDTH_NS
+            , typename TIMER::trigger_source_t TS = TIMER::ts_none
+            , bool RETRIGGER = false
+            , uint16_t PSC = 0
+            >
+    static void setup()
+    {
+        constexpr uint32_t delay = ticks(DELAY_NS, PSC) > 0 ? ticks(DELAY_NS, PSC) : 1;    // idle at CNT = 0
+        constexpr uint32_t width = ticks(WIDTH_NS, PSC);
+
+        static_assert(width > 0, "pulse width below timer resolution");
+        static_assert(delay + width - 1 <= static_cast<typename TIMER::count_t>(~0), "pulse too long, increase prescaler");
+#if !defined(STM32G0) && !defined(STM32G4)
+        static_assert(!RETRIGGER, "retriggerable one-pulse mode not available on this mcu");
+#endif
+        static_assert(!RETRIGGER || TS != TIMER::ts_none, "retriggerable one-pulse needs a trigger source");
+
+        pin::template setup<gpio::high_speed>();
+        peripheral_traits<_>::enable();
+        TIMER::TIM().CR1 = _::CR1_RESET_VALUE | _::CR1_OPM;    // stop counter at update event
+        TIMER::TIM().PSC = PSC;
+        TIMER::TIM().ARR = delay + width - 1;
+        __::CCR() = delay;
+        __::CCMR() &= ~(__::template CCMR_OCM<0x7> | (__::template CCMR_OCM<0x1> << 12));
+#if defined(STM32G0) || defined(STM32G4)
+        if (RETRIGGER)
+            __::CCMR() |= __::template CCMR_OCM<0x1>            // retriggerable opm mode 2 (1001),
+                       |  (__::template CCMR_OCM<0x1> << 12)    // OCxM[3] sits 12 bits above OCxM[0]
+                       ;
+        else
+#endif
+        __::CCMR() |= __::template CCMR_OCM<0x7>;               // pwm mode 2
+        TIMER::TIM().EGR = _::EGR_UG;                           // load prescaler and clear counter
+        TIMER::TIM().SR = 0;
+
+        if (TS != TIMER::ts_none)
+        {
+            TIMER::TIM().SMCR = _::SMCR_RESET_VALUE | _::template SMCR_TS<TS & 0x7>;
+#if defined(STM32G0) || defined(STM32G4)
+            if (RETRIGGER)
+                TIMER::TIM().SMCR |= _::SMCR_SMS_3;             // combined reset + trigger mode (1000)
+            else
+#endif
+            TIMER::TIM().SMCR |= _::template SMCR_SMS<0x6>;     // trigger mode, start counter on trigger
+        }
+
+        TIMER::TIM().CCER |= __::CCER_CCE;
+    }
+
+    // Configure TI1 or TI2 as the trigger input on PIN, with the edge that
+    // starts the pulse (use ts_ti1fp1 or ts_ti2fp2 in setup).
+
+    template<gpio::gpio_pin_t TPIN, channel_t TCH, gpio::trigger_edge_t EDGE = gpio::rising_edge, uint8_t FILTER = 0, gpio::input_type_t input_type = gpio::floating>
+    static void trigger_input()
+    {
+        static_assert(TCH == CH1 || TCH == CH2, "trigger input must be TI1 or TI2");
+        static_assert(EDGE != gpio::both_edges, "use ts_ti1f_ed to trigger on both edges of TI1");
+
+        typedef timer_capture_traits<TCH, TIMER> ___;
+
+        gpio::internal::alternate_t<TPIN, timer_altfun_traits<TCH, _>::altfun>::template setup<input_type>();
+        timer_channel_traits<TCH, TIMER>::CCMR() |= ___::template CCMR_CCS<0x1> | ___::template CCMR_ICF<FILTER>;
+        if (EDGE == gpio::falling_edge)
+            TIMER::TIM().CCER |= ___::CCER_CCP;
+    }
+
+    static void trigger()                                       // software trigger
+    {
+        if (TIMER::TIM().SMCR & _::template SMCR_SMS<0x7>)
+            TIMER::TIM().EGR = _::EGR_TG;                       // trigger event through slave controller
+        else
+            TIMER::TIM().CR1 |= _::CR1_CEN;                     // start counter
+    }
+
+    static bool busy()
+    {
+        return (TIMER::TIM().CR1 & _::CR1_CEN) != 0;
+    }
+};
+
+// WS2812 style led strip on a pwm channel. Each bit is one 800kHz pwm period
+// whose duty is streamed from the bit buffer by an update dma burst onto the
+// channel compare register. The trailing zero slot leaves the line low, the
+// caller must allow the 50us latch time between successive calls to show().
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, typename DMA, uint8_t DMACH, uint16_t NLEDS>
+class ws2812_t
+{
+public:
+    static void setup()
+    {
+        constexpr uint32_t period = TIMER::template frequency_setting<800000>().arr + 1;
+
+        TIMER::template setup_frequency<800000, 10000>();      // 1.25us bit period within 1%
+        pwm::setup(0);
+        s_t0h = (period * 8) / 25;                              // 0.4us high for zero bits
+        s_t1h = (period * 16) / 25;                             // 0.8us high for one bits
+        for (uint16_t i = 0; i < nslots; ++i)
+            s_buf[i] = i < 24 * NLEDS ? s_t0h : 0;
+    }
+
+    static void set(uint16_t i, uint8_t r, uint8_t g, uint8_t b)
+    {
+        uint32_t grb = (static_cast<uint32_t>(g) << 16) | (static_cast<uint32_t>(r) << 8) | b;
+        uint16_t *p = s_buf + 24 * i;
+
+        for (uint32_t m = 1 << 23; m; m >>= 1)                  // green, red, blue msb first
+            *p++ = (grb & m) ? s_t1h : s_t0h;
+    }
+
+    static void show()
+    {
+        TIMER::template dma_burst<DMA, DMACH, static_cast<typename TIMER::dma_burst_base_t>(TIMER::dba_ccr1 + CH), 1, uint16_t, dma::linear>(s_buf, nslots);
+    }
+
+    static bool busy()
+    {
+        return DMA::template remaining<DMACH>() != 0;
+    }
+
+private:
+    typedef pwm_t<TIMER, CH, PIN> pwm;
+    static constexpr uint16_t nslots = 24 * NLEDS + 1;
+
+    static uint16_t s_buf[nslots];
+    static uint16_t s_t0h, s_t1h;
+};
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, typename DMA, uint8_t DMACH, uint16_t NLEDS>
+uint16_t ws2812_t<TIMER, CH, PIN, DMA, DMACH, NLEDS>::s_buf[nslots];
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, typename DMA, uint8_t DMACH, uint16_t NLEDS>
+uint16_t ws2812_t<TIMER, CH, PIN, DMA, DMACH, NLEDS>::s_t0h;
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, typename DMA, uint8_t DMACH, uint16_t NLEDS>
+uint16_t ws2812_t<TIMER, CH, PIN, DMA, DMACH, NLEDS>::s_t1h;
+
+// Requantize q15 samples to BITS-bit pwm duty counts with error feedback.
+// ORDER 1 shapes the quantization noise by (1 - z^-1), ORDER 2 by (1 - z^-1)^2,
+// pushing it above the audio band where the pwm filter removes it.
+
+template<uint8_t BITS, uint8_t ORDER = 2>
+class pwm_noise_shaper_t
+{
+public:
+    pwm_noise_shaper_t(): m_e1(0), m_e2(0) {}
+
+    void reset()
+    {
+        m_e1 = m_e2 = 0;
+    }
+
+    void convert(const int16_t *src, uint16_t *dst, uint16_t n)
+    {
+        static_assert(BITS >= 4 && BITS <= 15, "pwm resolution out of range");
+        static_assert(ORDER <= 2, "noise shaping order out of range");
+
+        for (uint16_t i = 0; i < n; ++i)
+        {
+            int32_t x = static_cast<int32_t>(src[i]) + 32768;  // offset binary
+            int32_t v = x + (ORDER == 2 ? 2 * m_e1 - m_e2 : ORDER == 1 ? m_e1 : 0);
+            int32_t q = (v + (1 << (shift - 1))) >> shift;
+
+            if (q < 0)
+                q = 0;
+            else if (q > (1 << BITS))                           // CCR = ARR + 1 is full duty
+                q = 1 << BITS;
+
+            int32_t e = v - (q << shift);
+
+            if (e > limit)                                      // keep loop stable when clipping
+                e = limit;
+            else if (e < -limit)
+                e = -limit;
+            m_e2 = m_e1;
+            m_e1 = e;
+            dst[i] = q;
+        }
+    }
+
+private:
+    static constexpr uint8_t shift = 16 - BITS;
+    static constexpr int32_t limit = 1 << (shift + 1);
+
+    int32_t m_e1, m_e2;
+};
+
+// Pwm audio output. Duty counts stream from a double buffered ring into
+// CCRx by update dma (one sample per pwm period, or per REP + 1 periods on
+// advanced-control timers). The fill callback produces a block of q15 samples
+// from the dma interrupt (call isr from its handler) while the other half of
+// the ring plays, and the block is noise shaped into duty counts. Call
+// main_output_enable() on advanced-control timers.
+
+template
+    < typename TIMER, channel_t CH, gpio::gpio_pin_t PIN
+    , typename DMA, uint8_t DMACH
+    , uint8_t BITS = 10                         // pwm resolution
+    , uint16_t BLOCK_SIZE = 64                  // samples per half ring
+    , uint8_t ORDER = 2                         // noise shaping order
+    , uint8_t REP = 0                           // extra pwm periods per sample
+    >
+class pwm_dac_t
+{
+public:
+    typedef void (*fill_t)(int16_t *samples, uint16_t n);
+
+    static constexpr float sample_rate = static_cast<float>(timer_kernel_clock) / ((1ul << BITS) * (REP + 1));
+
+    static void setup(fill_t fill)
+    {
+        m_fill = fill;
+        m_shaper.reset();
+        for (uint16_t i = 0; i < 2 * BLOCK_SIZE; ++i)
+            m_duty[i] = 1 << (BITS - 1);                        // start at mid-scale
+
+        TIMER::setup(0, (1 << BITS) - 1);
+        if constexpr (REP > 0)
+            TIMER::repetition_count(REP);
+        pwm::setup(1 << (BITS - 1));
+        TIMER::template dma_burst<DMA, DMACH, static_cast<typename TIMER::dma_burst_base_t>(TIMER::dba_ccr1 + CH), 1, uint16_t, dma::circular>(m_duty, 2 * BLOCK_SIZE);
+        DMA::template enable_interrupt<DMACH, true>();
+    }
+
+    static inline void isr()
+    {
+        uint32_t sts = DMA::template interrupt_status<DMACH>();
+
+        DMA::template clear_interrupt_flags<DMACH>();
+
+        if (sts & (dma::dma_half_transfer | dma::dma_transfer_complete))
+        {
+            uint16_t offset = sts & dma::dma_transfer_complete ? BLOCK_SIZE : 0;
+
+            m_fill(m_samples, BLOCK_SIZE);
+            m_shaper.convert(m_samples, m_duty + offset, BLOCK_SIZE);
+        }
+    }
+
+private:
+    typedef pwm_t<TIMER, CH, PIN> pwm;
+
+    static uint16_t m_duty[2 * BLOCK_SIZE];
+    static int16_t m_samples[BLOCK_SIZE];
+    static pwm_noise_shaper_t<BITS, ORDER> m_shaper;
+    static fill_t m_fill;
+};
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, typename DMA, uint8_t DMACH, uint8_t BITS, uint16_t BLOCK_SIZE, uint8_t ORDER, uint8_t REP>
+uint16_t pwm_dac_t<TIMER, CH, PIN, DMA, DMACH, BITS, BLOCK_SIZE, ORDER, REP>::m_duty[2 * BLOCK_SIZE];
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, typename DMA, uint8_t DMACH, uint8_t BITS, uint16_t BLOCK_SIZE, uint8_t ORDER, uint8_t REP>
+int16_t pwm_dac_t<TIMER, CH, PIN, DMA, DMACH, BITS, BLOCK_SIZE, ORDER, REP>::m_samples[BLOCK_SIZE];
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, typename DMA, uint8_t DMACH, uint8_t BITS, uint16_t BLOCK_SIZE, uint8_t ORDER, uint8_t REP>
+pwm_noise_shaper_t<BITS, ORDER> pwm_dac_t<TIMER, CH, PIN, DMA, DMACH, BITS, BLOCK_SIZE, ORDER, REP>::m_shaper;
+
+template<typename TIMER, channel_t CH, gpio::gpio_pin_t PIN, typename DMA, uint8_t DMACH, uint8_t BITS, uint16_t BLOCK_SIZE, uint8_t ORDER, uint8_t REP>
+typename pwm_dac_t<TIMER, CH, PIN, DMA, DMACH, BITS, BLOCK_SIZE, ORDER, REP>::fill_t
+pwm_dac_t<TIMER, CH, PIN, DMA, DMACH, BITS, BLOCK_SIZE, ORDER, REP>::m_fill = 0;
+
 } // namespace timer
 
 } // namespace hal